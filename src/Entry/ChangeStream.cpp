@@ -0,0 +1,15 @@
+#include "Entry/ChangeStream.h"
+
+namespace HFloatingText::ChangeStream {
+
+uint64_t getVersion() { return DataManager::getInstance().getVersion(); }
+
+SubscriptionId subscribe(ChangeCallback callback) { return DataManager::getInstance().subscribe(std::move(callback)); }
+
+void unsubscribe(SubscriptionId id) { DataManager::getInstance().unsubscribe(id); }
+
+std::optional<std::vector<ChangeEvent>> getChangesSince(uint64_t version) {
+    return DataManager::getInstance().getChangesSince(version);
+}
+
+} // namespace HFloatingText::ChangeStream
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "Entry/DataManager.h"
+#include "Entry/Export.h"
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// 悬浮字变更流的导出接口，供其他模组链接 HFloatingText.lib 后使用。
+// 全部函数只能在服务器线程调用；回调同样在服务器线程执行，每个服务器刻最多一次。
+namespace HFloatingText::ChangeStream {
+
+// 当前数据版本
+HFT_API uint64_t getVersion();
+
+// 订阅变更，模组卸载前需调用 unsubscribe
+HFT_API SubscriptionId subscribe(ChangeCallback callback);
+HFT_API void           unsubscribe(SubscriptionId id);
+
+// 指定版本之后的全部变更；超出历史缓冲区范围时返回 nullopt，调用方需要重新全量同步
+HFT_API std::optional<std::vector<ChangeEvent>> getChangesSince(uint64_t version);
+
+} // namespace HFloatingText::ChangeStream
@@ -0,0 +1,23 @@
+#pragma once
+
+namespace HFloatingText {
+
+struct Config {
+    int version = 3;
+
+    struct Limits {
+        int maxTexts      = 1000; // 悬浮字总数上限
+        int maxTextLength = 1024; // 单条文本长度上限（字节）
+        int minInterval   = 100;  // 动态文本最小刷新间隔（毫秒）
+    } limits;
+
+    struct Storage {
+        bool sharded = false; // 按维度/命名空间拆分为多个文件存储
+    } storage;
+
+    struct Changes {
+        int historySize = 1024; // 变更历史缓冲区容量，用于按版本增量同步
+    } changes;
+};
+
+} // namespace HFloatingText
@@ -1,10 +1,17 @@
 #include "Entry/DataManager.h"
 #include "Entry/Entry.h"
+#include "Entry/MemoryEstimate.h"
+#include "fmt/format.h"
 #include "ll/api/io/FileUtils.h"
+#include "ll/api/thread/ServerThreadExecutor.h"
+#include "logger.h"
 #include "mc/deps/core/math/Vec3.h"
+#include <algorithm>
+#include <cctype>
 #include <fstream>
 #include <nlohmann/json.hpp>
 #include <filesystem>
+#include <string_view>
 
 namespace HFloatingText {
 
@@ -36,72 +43,681 @@ void from_json(const json& j, FloatingTextData& p) {
     }
 }
 
+namespace {
+// 检查单条文本的长度和刷新间隔限制
+std::optional<std::string> validateContent(const FloatingTextData& data) {
+    auto const& limits = Entry::getInstance().getConfig().limits;
+    if ((int)data.text.size() > limits.maxTextLength) {
+        return fmt::format("Text is too long ({} bytes, limit {}).", data.text.size(), limits.maxTextLength);
+    }
+    if (data.type == FloatingTextType::Dynamic && data.interval.has_value()
+        && data.interval.value() < limits.minInterval) {
+        return fmt::format("Interval {}ms is below the minimum of {}ms.", data.interval.value(), limits.minInterval);
+    }
+    return std::nullopt;
+}
+
+bool sameData(const FloatingTextData& a, const FloatingTextData& b) {
+    return a.text == b.text && a.pos.x == b.pos.x && a.pos.y == b.pos.y && a.pos.z == b.pos.z
+        && (int)a.dimid == (int)b.dimid && a.type == b.type && a.interval == b.interval;
+}
+} // namespace
+
 DataManager& DataManager::getInstance() {
     static DataManager instance;
     return instance;
 }
 
 DataManager::DataManager() {
-    mFilePath = (Entry::getInstance().getSelf().getDataDir() / "floating_texts.json").string();
+    auto dataDir = Entry::getInstance().getSelf().getDataDir();
+    mFilePath    = (dataDir / "floating_texts.json").string();
+    mShardDir    = dataDir / "texts";
+}
+
+DataManager::DataManager(std::unordered_map<std::string, FloatingTextData> texts)
+: mFloatingTexts(std::move(texts)),
+  mInMemory(true) {
+    auto& shard  = mShards[""];
+    shard.loaded = true;
+    for (auto const& [name, data] : mFloatingTexts) {
+        shard.names.insert(name);
+    }
+}
+
+std::filesystem::path DataManager::shardPath(const std::string& key) const {
+    if (key.empty()) {
+        return std::filesystem::path(mFilePath);
+    }
+    return mShardDir / (key + ".json");
+}
+
+std::string DataManager::shardKeyFor(const std::string& name, const FloatingTextData& data) const {
+    if (!mSharded) {
+        return {};
+    }
+    // 名称带有 "<命名空间>/" 前缀时归入命名空间分片，否则按维度分片
+    auto slash = name.find('/');
+    if (slash != std::string::npos && slash > 0) {
+        auto ns    = std::string_view(name).substr(0, slash);
+        bool valid = std::all_of(ns.begin(), ns.end(), [](char c) {
+            return std::isalnum((unsigned char)c) || c == '_' || c == '-';
+        });
+        if (valid) {
+            return fmt::format("ns/{}", ns);
+        }
+    }
+    return fmt::format("dim/{}", (int)data.dimid);
+}
+
+std::optional<std::string> DataManager::findShardOf(const std::string& name) const {
+    for (auto const& [key, shard] : mShards) {
+        if (shard.names.contains(name)) {
+            return key;
+        }
+    }
+    return std::nullopt;
+}
+
+std::vector<std::string> DataManager::getShardTextNames(const std::string& key) const {
+    auto it = mShards.find(key);
+    if (it == mShards.end()) {
+        return {};
+    }
+    return {it->second.names.begin(), it->second.names.end()};
 }
 
 bool DataManager::load() {
-    if (!std::filesystem::exists(mFilePath)) {
-        return save(); // Create an empty file if it doesn't exist
+    mSharded = Entry::getInstance().getConfig().storage.sharded;
+    if (!mSharded) {
+        if (mShards.size() != 1 || !mShards.contains("")) {
+            clearAll();
+        }
+        // 从分片模式切换回来时先合并分片，否则分片中的文本会全部丢失
+        if (std::filesystem::exists(mShardDir) && !mergeShardsIntoSingleFile()) {
+            logger.error(
+                "Failed to merge shards in {} back into {}. Set storage.sharded to true or merge them manually.",
+                mShardDir.string(),
+                mFilePath
+            );
+            return false;
+        }
+        bool fileExists = std::filesystem::exists(mFilePath);
+        if (!loadShard("")) {
+            return false;
+        }
+        return fileExists || save(); // Create an empty file if it doesn't exist
     }
 
-    std::ifstream file(mFilePath);
-    if (!file.is_open()) {
+    if (std::filesystem::exists(mFilePath) && !migrateFromSingleFile()) {
+        logger.error("Failed to migrate {} to sharded storage.", mFilePath);
         return false;
     }
 
+    // 从单文件模式切换过来时丢弃旧数据，否则保留已加载分片并在下方逐个重新加载
+    if (mShards.contains("")) {
+        clearAll();
+    }
+    std::error_code ec;
+    for (auto const& entry : std::filesystem::recursive_directory_iterator(mShardDir, ec)) {
+        if (!entry.is_regular_file() || entry.path().extension() != ".json") {
+            continue;
+        }
+        auto key = std::filesystem::relative(entry.path(), mShardDir).replace_extension().generic_string();
+        if (key.starts_with("ns/") || key.starts_with("dim/")) {
+            mShards.try_emplace(key);
+        }
+    }
+    loadShardIndex();
+
+    // 命名空间分片可能跨越多个维度，立即加载；维度分片等到有玩家进入该维度时再加载
+    bool success = true;
+    for (auto const& [key, shard] : mShards) {
+        if ((key.starts_with("ns/") || shard.loaded) && !loadShard(key)) {
+            success = false;
+        }
+    }
+    return success;
+}
+
+void DataManager::loadShardIndex() {
+    mShardIndex.clear();
+    bool complete = false;
+    if (std::ifstream file(indexPath()); file.is_open()) {
+        try {
+            json j;
+            file >> j;
+            for (auto& [name, value] : j.items()) {
+                auto key = value.get<std::string>();
+                if (mShards.contains(key)) {
+                    mShardIndex.emplace(name, std::move(key));
+                }
+            }
+            complete = true;
+        } catch (const json::exception&) {
+            mShardIndex.clear();
+        }
+    }
+    if (complete) {
+        return;
+    }
+
+    // 索引缺失或损坏时读取各分片的键名重建一次
+    logger.info("Rebuilding floating text shard index...");
+    for (auto const& [key, shard] : mShards) {
+        std::ifstream file(shardPath(key));
+        if (!file.is_open()) {
+            continue;
+        }
+        try {
+            json j;
+            file >> j;
+            for (auto const& [name, value] : j.items()) {
+                mShardIndex.try_emplace(name, key);
+            }
+        } catch (const json::exception&) {
+            logger.error("Floating text shard {} is malformed.", key);
+        }
+    }
+    if (!saveShardIndex()) {
+        logger.error("Failed to save floating text shard index.");
+    }
+}
+
+bool DataManager::saveShardIndex() const {
     try {
-        json j;
-        file >> j;
-        mFloatingTexts = j.get<std::unordered_map<std::string, FloatingTextData>>();
+        std::filesystem::create_directories(mShardDir);
+    } catch (const std::filesystem::filesystem_error&) {
+        return false; // Failed to create directory
+    }
+    std::ofstream file(indexPath());
+    if (!file.is_open()) {
+        return false;
+    }
+    try {
+        json j = json::object();
+        for (auto const& [name, key] : mShardIndex) {
+            j[name] = key;
+        }
+        file << j.dump(4);
     } catch (const json::exception&) {
         return false;
     }
+    return true;
+}
+
+void DataManager::updateShardIndex(const std::string& key) {
+    if (!mSharded || mInMemory) {
+        return;
+    }
+    auto const& shard   = mShards[key];
+    auto const& names   = shard.names;
+    bool        changed = false;
+    for (auto it = mShardIndex.begin(); it != mShardIndex.end();) {
+        if (it->second == key && !names.contains(it->first) && !shard.rejected.contains(it->first)) {
+            it      = mShardIndex.erase(it);
+            changed = true;
+        } else {
+            ++it;
+        }
+    }
+    for (auto const& name : names) {
+        auto [it, inserted] = mShardIndex.try_emplace(name, key);
+        if (!inserted && it->second != key) {
+            it->second = key;
+            inserted   = true;
+        }
+        changed = changed || inserted;
+    }
+    // 被跳过的条目仍在磁盘上，保留索引项；与其他分片重名时不覆盖
+    for (auto const& [name, raw] : shard.rejected) {
+        changed = mShardIndex.try_emplace(name, key).second || changed;
+    }
+    if (changed && !saveShardIndex()) {
+        logger.error("Failed to save floating text shard index.");
+    }
+}
+
+bool DataManager::loadShard(const std::string& key) {
+    if (mInMemory) {
+        return true; // 内存实例不读取文件
+    }
+    auto& shard = mShards[key];
+    auto  path  = shardPath(key);
+
+    // 总数限制按所有分片合计计算
+    auto const& limits = Entry::getInstance().getConfig().limits;
+    size_t      others = mFloatingTexts.size() - shard.names.size();
+    std::unordered_map<std::string, FloatingTextData> loaded;
+    std::map<std::string, std::string>                rejected;
+    if (std::filesystem::exists(path)) {
+        std::ifstream file(path);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        try {
+            json j;
+            file >> j;
+            file.close();
+            for (auto& [name, value] : j.items()) {
+                FloatingTextData data = value.get<FloatingTextData>();
+                // 逐条检查容量限制，跳过不合法的条目而不是整体失败
+                std::optional<std::string> error;
+                if ((int)(others + loaded.size()) >= limits.maxTexts) {
+                    error = fmt::format("Floating text limit of {} reached.", limits.maxTexts);
+                } else if (!shard.names.contains(name) && mFloatingTexts.contains(name)) {
+                    error = "A floating text with the same name exists in another shard.";
+                } else {
+                    error = validateContent(data);
+                }
+                if (error) {
+                    // 只是不加载，文件中的条目保持不变
+                    logger.error("Skipping floating text {}: {} It is kept on disk unchanged.", name, *error);
+                    rejected.emplace(name, value.dump());
+                    continue;
+                }
+                loaded.emplace(name, std::move(data));
+            }
+        } catch (const json::exception&) {
+            return false;
+        }
+    }
 
+    // 与当前数据比较，只记录实际发生的变更
+    for (auto const& name : shard.names) {
+        if (!loaded.contains(name)) {
+            mFloatingTexts.erase(name);
+            recordChange(ChangeType::Removed, name, nullptr);
+        }
+    }
+    shard.names.clear();
+    for (auto& [name, data] : loaded) {
+        shard.names.insert(name);
+        auto it = mFloatingTexts.find(name);
+        if (it == mFloatingTexts.end()) {
+            it = mFloatingTexts.emplace(name, std::move(data)).first;
+            recordChange(ChangeType::Added, name, &it->second);
+        } else if (!sameData(it->second, data)) {
+            it->second = std::move(data);
+            recordChange(ChangeType::Updated, name, &it->second);
+        }
+    }
+    shard.rejected = std::move(rejected);
+    shard.loaded   = true;
+    updateShardIndex(key);
+    if (mShardLoadedCallback) {
+        mShardLoadedCallback(getShardTextNames(key));
+    }
     return true;
 }
 
-bool DataManager::save() {
+bool DataManager::saveShard(const std::string& key) {
+    if (mInMemory) {
+        return true; // 内存实例不写入文件
+    }
+    auto it = mShards.find(key);
+    if (it == mShards.end() || !it->second.loaded) {
+        return false; // 未加载的分片不能保存，否则会覆盖磁盘上的数据
+    }
+
+    auto filePath = shardPath(key);
     try {
-        std::filesystem::path filePath(mFilePath);
         if (!std::filesystem::exists(filePath.parent_path())) {
             std::filesystem::create_directories(filePath.parent_path());
         }
+        // 空分片直接删除文件
+        if (mSharded && it->second.names.empty() && it->second.rejected.empty()) {
+            std::filesystem::remove(filePath);
+            updateShardIndex(key);
+            return true;
+        }
     } catch (const std::filesystem::filesystem_error&) {
         return false; // Failed to create directory
     }
 
-    std::ofstream file(mFilePath);
+    std::ofstream file(filePath);
     if (!file.is_open()) {
         return false;
     }
 
     try {
-        json j = mFloatingTexts;
+        // 加载时被跳过的条目原样写回
+        json j = json::object();
+        for (auto const& [name, raw] : it->second.rejected) {
+            j[name] = json::parse(raw);
+        }
+        for (auto const& name : it->second.names) {
+            j[name] = mFloatingTexts.at(name);
+        }
         file << j.dump(4);
     } catch (const json::exception&) {
         return false;
     }
 
+    updateShardIndex(key);
+    return true;
+}
+
+bool DataManager::reloadShard(const std::string& key) {
+    if (!mShards.contains(key)) {
+        return false;
+    }
+    return loadShard(key);
+}
+
+bool DataManager::save() {
+    bool success = true;
+    for (auto const& [key, shard] : mShards) {
+        if (shard.loaded && !saveShard(key)) {
+            success = false;
+        }
+    }
+    return success;
+}
+
+void DataManager::ensureDimensionLoaded(DimensionType dimid) {
+    if (!mSharded) {
+        return;
+    }
+    auto it = mShards.find(fmt::format("dim/{}", (int)dimid));
+    if (it != mShards.end() && !it->second.loaded) {
+        logger.debug("Loading floating text shard {}", it->first);
+        if (!loadShard(it->first)) {
+            logger.error("Failed to load floating text shard {}", it->first);
+        }
+    }
+}
+
+bool DataManager::hasFloatingText(const std::string& name) const {
+    return mFloatingTexts.contains(name) || mShardIndex.contains(name);
+}
+
+const FloatingTextData* DataManager::findFloatingText(const std::string& name) {
+    if (auto index = mShardIndex.find(name); index != mShardIndex.end()) {
+        auto shard = mShards.find(index->second);
+        if (shard != mShards.end() && !shard->second.loaded && !loadShard(shard->first)) {
+            logger.error("Failed to load floating text shard {}", shard->first);
+        }
+    }
+    auto it = mFloatingTexts.find(name);
+    return it != mFloatingTexts.end() ? &it->second : nullptr;
+}
+
+bool DataManager::migrateFromSingleFile() {
+    std::ifstream file(mFilePath);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::map<std::string, json> shards;
+    try {
+        json j;
+        file >> j;
+        file.close();
+        for (auto& [name, value] : j.items()) {
+            auto key          = shardKeyFor(name, value.get<FloatingTextData>());
+            shards[key][name] = std::move(value);
+        }
+    } catch (const json::exception&) {
+        return false;
+    }
+
+    try {
+        for (auto& [key, content] : shards) {
+            auto path = shardPath(key);
+            std::filesystem::create_directories(path.parent_path());
+            // 分片文件已存在时合并，单文件中的条目优先
+            if (std::filesystem::exists(path)) {
+                std::ifstream in(path);
+                json          existing;
+                in >> existing;
+                existing.update(content);
+                content = std::move(existing);
+            }
+            std::ofstream out(path);
+            if (!out.is_open()) {
+                return false;
+            }
+            out << content.dump(4);
+        }
+        std::filesystem::rename(mFilePath, mFilePath + ".bak");
+        // 分片文件已改写，旧索引作废，加载时重建
+        std::filesystem::remove(indexPath());
+    } catch (const std::filesystem::filesystem_error&) {
+        return false;
+    } catch (const json::exception&) {
+        return false;
+    }
+
+    logger.info("Migrated {} to {} shard files.", mFilePath, shards.size());
+    return true;
+}
+
+bool DataManager::mergeShardsIntoSingleFile() {
+    json   merged = json::object();
+    size_t count  = 0;
+    try {
+        std::error_code ec;
+        for (auto const& entry : std::filesystem::recursive_directory_iterator(mShardDir, ec)) {
+            if (!entry.is_regular_file() || entry.path().extension() != ".json") {
+                continue;
+            }
+            auto key = std::filesystem::relative(entry.path(), mShardDir).replace_extension().generic_string();
+            if (!key.starts_with("ns/") && !key.starts_with("dim/")) {
+                continue; // 跳过名称索引
+            }
+            std::ifstream in(entry.path());
+            json          content;
+            in >> content;
+            merged.update(content);
+            ++count;
+        }
+        if (ec) {
+            return false;
+        }
+
+        // 单文件已存在时合并，单文件中的条目优先
+        if (std::filesystem::exists(mFilePath)) {
+            std::ifstream in(mFilePath);
+            json          existing;
+            in >> existing;
+            merged.update(existing);
+        }
+        std::ofstream out(mFilePath);
+        if (!out.is_open()) {
+            return false;
+        }
+        out << merged.dump(4);
+        out.close();
+
+        // 已有备份目录时使用带序号的名称，避免覆盖
+        auto backup = mShardDir;
+        backup += ".bak";
+        for (int i = 1; std::filesystem::exists(backup); ++i) {
+            backup = mShardDir;
+            backup += fmt::format(".bak.{}", i);
+        }
+        std::filesystem::rename(mShardDir, backup);
+    } catch (const std::filesystem::filesystem_error&) {
+        return false;
+    } catch (const json::exception&) {
+        return false;
+    }
+
+    logger.info("Merged {} shard files back into {}.", count, mFilePath);
     return true;
 }
 
 void DataManager::addOrUpdateFloatingText(const std::string& name, FloatingTextData data) {
-    mFloatingTexts[name] = data;
-    save();
+    auto key = shardKeyFor(name, data);
+    if (mSharded && !mShards[key].loaded) {
+        loadShard(key);
+    }
+    // 文本所属分片发生变化时，从旧分片中移除
+    auto oldKey = findShardOf(name);
+    if (oldKey && *oldKey != key) {
+        mShards[*oldKey].names.erase(name);
+        saveShard(*oldKey);
+    }
+    mShards[key].names.insert(name);
+    auto [it, inserted] = mFloatingTexts.insert_or_assign(name, std::move(data));
+    recordChange(inserted ? ChangeType::Added : ChangeType::Updated, name, &it->second);
+    saveShard(key);
 }
 
 void DataManager::removeFloatingText(const std::string& name) {
+    findFloatingText(name); // 所在分片未加载时先加载，否则无法保存
     if (mFloatingTexts.erase(name) > 0) {
-        save();
+        recordChange(ChangeType::Removed, name, nullptr);
+        if (auto key = findShardOf(name)) {
+            mShards[*key].names.erase(name);
+            saveShard(*key);
+        }
     }
 }
 
 std::unordered_map<std::string, FloatingTextData>& DataManager::getAllFloatingTexts() { return mFloatingTexts; }
 
+void DataManager::clearAll() {
+    for (auto const& [name, data] : mFloatingTexts) {
+        recordChange(ChangeType::Removed, name, nullptr);
+    }
+    mFloatingTexts.clear();
+    mShards.clear();
+    mShardIndex.clear();
+}
+
+void DataManager::recordChange(ChangeType type, const std::string& name, const FloatingTextData* data) {
+    if (mInMemory) {
+        return;
+    }
+    ChangeEvent event{++mVersion, type, name, data ? std::optional(*data) : std::nullopt};
+
+    // 历史缓冲区有界，超出容量时丢弃最旧的变更
+    size_t capacity = (size_t)std::max(Entry::getInstance().getConfig().changes.historySize, 0);
+    mHistory.push_back(event);
+    while (mHistory.size() > capacity) {
+        mHistory.pop_front();
+    }
+
+    if (mSubscribers.empty()) {
+        return;
+    }
+
+    // 合并同一文本在本刻内的多次变更
+    auto it = mPendingChanges.find(name);
+    if (it == mPendingChanges.end()) {
+        mPendingOrder.push_back(name);
+        mPendingChanges.emplace(name, std::move(event));
+    } else {
+        auto previous = it->second.type;
+        if (previous == ChangeType::Added && type == ChangeType::Removed) {
+            mPendingChanges.erase(it); // 本刻内新增后又删除，对订阅者不可见
+        } else {
+            if (previous == ChangeType::Added) {
+                event.type = ChangeType::Added;
+            } else if (previous == ChangeType::Removed && type == ChangeType::Added) {
+                event.type = ChangeType::Updated;
+            }
+            it->second = std::move(event);
+        }
+    }
+
+    if (!mFlushScheduled) {
+        mFlushScheduled = true;
+        ll::thread::ServerThreadExecutor::getDefault().execute([this] { flushChanges(); });
+    }
+}
+
+void DataManager::flushChanges() {
+    mFlushScheduled = false;
+    std::vector<ChangeEvent> batch;
+    batch.reserve(mPendingChanges.size());
+    for (auto const& name : mPendingOrder) {
+        auto it = mPendingChanges.find(name);
+        if (it != mPendingChanges.end()) {
+            batch.push_back(std::move(it->second));
+            mPendingChanges.erase(it);
+        }
+    }
+    mPendingOrder.clear();
+    mPendingChanges.clear();
+    if (batch.empty()) {
+        return;
+    }
+
+    // 复制一份订阅者列表，允许回调中取消订阅；已被取消的订阅者不再回调
+    auto subscribers = mSubscribers;
+    for (auto const& [id, callback] : subscribers) {
+        if (mSubscribers.contains(id)) {
+            callback(batch);
+        }
+    }
+}
+
+SubscriptionId DataManager::subscribe(ChangeCallback callback) {
+    auto id = mNextSubscriptionId++;
+    mSubscribers.emplace(id, std::move(callback));
+    return id;
+}
+
+void DataManager::unsubscribe(SubscriptionId id) { mSubscribers.erase(id); }
+
+std::optional<std::vector<ChangeEvent>> DataManager::getChangesSince(uint64_t version) const {
+    if (version >= mVersion) {
+        return std::vector<ChangeEvent>{};
+    }
+    uint64_t oldest = mHistory.empty() ? mVersion + 1 : mHistory.front().version;
+    if (version + 1 < oldest) {
+        return std::nullopt;
+    }
+    return std::vector<ChangeEvent>(mHistory.begin() + (ptrdiff_t)(version + 1 - oldest), mHistory.end());
+}
+
+std::optional<std::string> DataManager::validate(const std::string& name, const FloatingTextData& data) const {
+    auto const& limits = Entry::getInstance().getConfig().limits;
+    // 分片模式下索引包含尚未加载的文本
+    size_t count = std::max(mFloatingTexts.size(), mShardIndex.size());
+    if (!hasFloatingText(name) && (int)count >= limits.maxTexts) {
+        return fmt::format("Floating text limit of {} reached.", limits.maxTexts);
+    }
+    return validateContent(data);
+}
+
+size_t DataManager::estimateMemoryUsage() const {
+    size_t total = mFloatingTexts.bucket_count() * 2 * sizeof(void*);
+    for (auto const& [name, data] : mFloatingTexts) {
+        total += kNodeBytes<FloatingTextData> + stringHeapBytes(name) + stringHeapBytes(data.text);
+    }
+    total += mShardIndex.bucket_count() * 2 * sizeof(void*);
+    for (auto const& [name, key] : mShardIndex) {
+        total += kNodeBytes<std::string> + stringHeapBytes(name) + stringHeapBytes(key);
+    }
+    for (auto const& [key, shard] : mShards) {
+        for (auto const& [name, raw] : shard.rejected) {
+            total += kNodeBytes<std::string> + stringHeapBytes(name) + stringHeapBytes(raw);
+        }
+    }
+    return total;
+}
+
+size_t DataManager::estimateHistoryMemoryUsage() const {
+    size_t total = 0;
+    for (auto const& event : mHistory) {
+        total += sizeof(ChangeEvent) + stringHeapBytes(event.name);
+        if (event.data) {
+            total += stringHeapBytes(event.data->text);
+        }
+    }
+    return total;
+}
+
+size_t DataManager::estimateTextMemoryUsage(const std::string& name) const {
+    auto it = mFloatingTexts.find(name);
+    if (it == mFloatingTexts.end()) {
+        return 0;
+    }
+    return kNodeBytes<FloatingTextData> + stringHeapBytes(it->first) + stringHeapBytes(it->second.text);
+}
+
 } // namespace HFloatingText
\ No newline at end of file
@@ -2,9 +2,18 @@
 
 #include "mc/deps/core/math/Vec3.h"
 #include "mc/world/level/dimension/Dimension.h"
+#include <nlohmann/json_fwd.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <map>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <optional>
+#include <vector>
 
 namespace HFloatingText {
 
@@ -18,28 +27,134 @@ struct FloatingTextData {
     std::optional<int> interval; // Only for dynamic text
 };
 
+void to_json(nlohmann::json& j, const FloatingTextData& p);
+void from_json(const nlohmann::json& j, FloatingTextData& p);
+
+enum class ChangeType { Added, Updated, Removed };
+
+struct ChangeEvent {
+    uint64_t                        version; // 产生该变更后的数据版本
+    ChangeType                      type;
+    std::string                     name;
+    std::optional<FloatingTextData> data; // Removed 时为空
+};
+
+// 每个服务器刻最多回调一次，同一文本的多次变更会合并为一条
+using ChangeCallback = std::function<void(std::vector<ChangeEvent> const&)>;
+using SubscriptionId = uint64_t;
+
+// 分片加载（或重新加载）完成后同步调用，参数为该分片当前的全部文本名称
+using ShardLoadedCallback = std::function<void(std::vector<std::string> const&)>;
+
 class DataManager {
 public:
     static DataManager& getInstance();
 
+    // 内存实例：只持有给定的文本，不读写文件、不产生变更事件，供回放模拟使用
+    explicit DataManager(std::unordered_map<std::string, FloatingTextData> texts);
+    ~DataManager() = default;
+
     DataManager(const DataManager&)            = delete;
     DataManager(DataManager&&)                 = delete;
     DataManager& operator=(const DataManager&) = delete;
     DataManager& operator=(DataManager&&)      = delete;
 
+    // 单文件模式读取全部文本；分片模式登记所有分片，命名空间分片立即加载，维度分片按需加载
     bool load();
+    // 保存所有已加载的分片
     bool save();
 
+    // 分片存储：命名空间文本（如 "lobby/welcome"）存于 texts/ns/<命名空间>.json，
+    // 其余文本按维度存于 texts/dim/<维度ID>.json。单文件模式下只有键为空的一个分片。
+    bool loadShard(const std::string& key);
+    bool saveShard(const std::string& key);
+    bool reloadShard(const std::string& key);
+
+    // 加载玩家所在维度的分片（如尚未加载）
+    void ensureDimensionLoaded(DimensionType dimid);
+
+    // 任何路径加载分片后都会通知该回调，显示层据此登记新加载的文本
+    void setShardLoadedCallback(ShardLoadedCallback callback) { mShardLoadedCallback = std::move(callback); }
+
+    // 将 floating_texts.json 拆分为分片文件，原文件重命名为 .bak
+    bool migrateFromSingleFile();
+    // 反向迁移：将 texts/ 下的分片合并回 floating_texts.json，分片目录重命名为 texts.bak
+    bool mergeShardsIntoSingleFile();
+
+    [[nodiscard]] bool                     isSharded() const { return mSharded; }
+    [[nodiscard]] bool                     hasShard(const std::string& key) const { return mShards.contains(key); }
+    [[nodiscard]] std::string              shardKeyFor(const std::string& name, const FloatingTextData& data) const;
+    [[nodiscard]] std::vector<std::string> getShardTextNames(const std::string& key) const;
+
+    // 查找文本是否存在；分片模式下按名称索引判断，不加载分片
+    [[nodiscard]] bool hasFloatingText(const std::string& name) const;
+    // 获取文本数据，所在分片尚未加载时只加载该分片；不存在时返回 nullptr
+    const FloatingTextData* findFloatingText(const std::string& name);
+
     void addOrUpdateFloatingText(const std::string& name, FloatingTextData data);
     void removeFloatingText(const std::string& name);
     std::unordered_map<std::string, FloatingTextData>& getAllFloatingTexts();
 
+    // 当前数据版本，每次变更单调递增
+    [[nodiscard]] uint64_t getVersion() const { return mVersion; }
+
+    // 订阅变更事件，返回的 ID 用于取消订阅（其他模组请使用 ChangeStream.h 中的导出接口）
+    SubscriptionId subscribe(ChangeCallback callback);
+    void           unsubscribe(SubscriptionId id);
+
+    // 获取指定版本之后的全部变更；若该版本已超出历史缓冲区范围则返回 nullopt，调用方需要重新全量同步
+    [[nodiscard]] std::optional<std::vector<ChangeEvent>> getChangesSince(uint64_t version) const;
+
+    // 按配置中的容量限制检查文本，超出限制时返回错误信息
+    [[nodiscard]] std::optional<std::string> validate(const std::string& name, const FloatingTextData& data) const;
+
+    // 估算数据部分占用的内存（字节）
+    [[nodiscard]] size_t estimateMemoryUsage() const;
+    [[nodiscard]] size_t estimateTextMemoryUsage(const std::string& name) const;
+    [[nodiscard]] size_t estimateHistoryMemoryUsage() const;
+
 private:
     DataManager();
-    ~DataManager() = default;
+
+    struct Shard {
+        bool                            loaded = false;
+        std::unordered_set<std::string> names;
+        // 加载时因超出限制或重名被跳过的条目（名称 -> 原始 JSON），保存时原样写回，避免丢失磁盘上的数据
+        std::map<std::string, std::string> rejected;
+    };
+
+    [[nodiscard]] std::filesystem::path      shardPath(const std::string& key) const;
+    [[nodiscard]] std::optional<std::string> findShardOf(const std::string& name) const;
+
+    // 名称索引 texts/index.json：记录每个文本所在的分片，未加载的分片也能按名称查找
+    [[nodiscard]] std::filesystem::path indexPath() const { return mShardDir / "index.json"; }
+    void                                loadShardIndex();
+    bool                                saveShardIndex() const;
+    // 将索引中该分片的条目与已加载的名称同步，有变化时写回文件
+    void                                updateShardIndex(const std::string& key);
+
+    // 记录一次变更：写入历史缓冲区并加入待合并队列
+    void recordChange(ChangeType type, const std::string& name, const FloatingTextData* data);
+    void clearAll();
+    void flushChanges();
 
     std::string                                        mFilePath;
+    std::filesystem::path                              mShardDir;
+    bool                                               mSharded = false;
+    std::map<std::string, Shard>                       mShards;
     std::unordered_map<std::string, FloatingTextData> mFloatingTexts;
+    std::unordered_map<std::string, std::string>      mShardIndex; // 名称 -> 分片键，仅分片模式使用
+
+    uint64_t                                     mVersion = 0;
+    std::deque<ChangeEvent>                      mHistory;
+    std::unordered_map<std::string, ChangeEvent> mPendingChanges;
+    std::vector<std::string>                     mPendingOrder;
+    bool                                         mFlushScheduled     = false;
+    SubscriptionId                               mNextSubscriptionId = 1;
+    std::map<SubscriptionId, ChangeCallback>     mSubscribers;
+
+    bool                mInMemory = false;
+    ShardLoadedCallback mShardLoadedCallback;
 };
 
 } // namespace HFloatingText
\ No newline at end of file
@@ -1,6 +1,9 @@
 #include "Entry/Entry.h"
 #include "Entry/Register.h"
 #include "Entry/DataManager.h"
+#include "Entry/ReplayDriver.h"
+#include "Entry/TraceRecorder.h"
+#include "ll/api/Config.h"
 #include "ll/api/mod/RegisterHelper.h"
 #include <string>
 #include <unordered_map>
@@ -20,9 +23,21 @@ Entry& Entry::getInstance() {
 
 bool Entry::load() {
     getSelf().getLogger().debug("Loading...");
+    const auto& configFilePath = getSelf().getConfigDir() / "config.json";
+    if (!ll::config::loadConfig(mConfig, configFilePath)) {
+        getSelf().getLogger().warn("Cannot load configurations from {}", configFilePath);
+        getSelf().getLogger().info("Saving default configurations");
+        if (!ll::config::saveConfig(mConfig, configFilePath)) {
+            getSelf().getLogger().error("Cannot save default configurations to {}", configFilePath);
+        }
+    }
     return true;
 }
 
+bool Entry::saveConfig() {
+    return ll::config::saveConfig(mConfig, getSelf().getConfigDir() / "config.json");
+}
+
 bool Entry::enable() {
     getSelf().getLogger().debug("Enabling...");
     if (!DataManager::getInstance().load()) {
@@ -36,6 +51,8 @@ bool Entry::enable() {
 
 bool Entry::disable() {
     getSelf().getLogger().debug("Disabling...");
+    TraceRecorder::getInstance().stop();
+    ReplayDriver::getInstance().cancel();
     FloatingTextManager::getInstance().unloadAllTexts(); // 卸载所有文本
     return true;
 }
@@ -51,6 +68,26 @@ void Entry::reloadAllFloatingTexts() {
     }
 }
 
+bool Entry::reloadShard(const std::string& key) {
+    getSelf().getLogger().debug("Reloading floating text shard {}...", key);
+    auto& dataManager = DataManager::getInstance();
+    auto& textManager = FloatingTextManager::getInstance();
+    for (auto const& name : dataManager.getShardTextNames(key)) {
+        textManager.removeText(name);
+    }
+    // 重新加载成功后，分片中的文本由 FloatingTextManager::onShardLoaded 重新登记
+    bool success = dataManager.reloadShard(key);
+    if (!success) {
+        getSelf().getLogger().error("Failed to reload floating text shard {}!", key);
+        // 加载失败时数据未变，恢复原有文本
+        auto& allTexts = dataManager.getAllFloatingTexts();
+        for (auto const& name : dataManager.getShardTextNames(key)) {
+            textManager.registerText(name, allTexts.at(name));
+        }
+    }
+    return success;
+}
+
 } // namespace HFloatingText
 
 LL_REGISTER_MOD(HFloatingText::Entry, HFloatingText::Entry::getInstance());
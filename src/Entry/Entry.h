@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Entry/Config.h"
 #include "ll/api/mod/NativeMod.h"
 #include "debug_shape/api/shape/IDebugText.h" // 引入 DebugText 头文件
 #include "Entry/FloatingTextManager.h"
@@ -18,6 +19,8 @@ class Entry {
 
     [[nodiscard]] ll::mod::NativeMod& getSelf() const { return mSelf; }
 
+    [[nodiscard]] Config& getConfig() { return mConfig; }
+
     /// @return True if the mod is loaded successfully.
     bool load();
 
@@ -27,8 +30,14 @@ class Entry {
     /// @return True if the mod is disabled successfully.
     bool disable();
 
+    /// @return True if the configuration is saved successfully.
+    bool saveConfig();
+
     void reloadAllFloatingTexts();
 
+    /// @return True if the shard is reloaded successfully.
+    bool reloadShard(const std::string& key);
+
     // 获取 DebugText 对象的管理器
     // 移除 getDebugTexts 方法，因为 FloatingTextManager 现在直接管理 DebugText 实例
 
@@ -38,6 +47,7 @@ class Entry {
 
 private:
     ll::mod::NativeMod& mSelf;
+    Config              mConfig;
     // 移除 mDebugTexts，因为 FloatingTextManager 现在直接管理 DebugText 实例
 };
 
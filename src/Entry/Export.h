@@ -0,0 +1,9 @@
+#pragma once
+
+// 供其他模组链接的符号。构建本模组时定义 HFLOATINGTEXT_EXPORTS（见 xmake.lua），
+// 依赖方直接包含头文件即为导入
+#ifdef HFLOATINGTEXT_EXPORTS
+#define HFT_API __declspec(dllexport)
+#else
+#define HFT_API __declspec(dllimport)
+#endif
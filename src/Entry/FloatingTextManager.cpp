@@ -1,5 +1,6 @@
 #include "Entry/FloatingTextManager.h"
 #include "Entry/Entry.h"
+#include "Entry/MemoryEstimate.h"
 #include "PA/PlaceholderAPI.h" 
 #include "ll/api/coro/CoroTask.h"
 #include "ll/api/service/Bedrock.h"
@@ -11,98 +12,233 @@
 #include "debug_shape/api/IDebugShapeDrawer.h"
 
 
+#include <algorithm>
 #include <chrono>
-#include <iomanip> // For std::put_time
-#include <sstream> // For std::ostringstream
+#include <cmath>
+#include <ctime>
 
 namespace HFloatingText {
 
-FloatingTextManager::FloatingTextManager() : mRunning(false) {}
+FloatingTextManager::FloatingTextManager(DataManager& data) : mData(data), mRunning(false) {
+    mData.setShardLoadedCallback([this](std::vector<std::string> const& names) { onShardLoaded(names); });
+}
 
 FloatingTextManager::~FloatingTextManager() {
-    unloadAllTexts();
+    mData.setShardLoadedCallback(nullptr);
+    if (mRunning) {
+        unloadAllTexts();
+    }
     // 清除所有 DebugText 实例
     mDebugTexts.clear();
 }
 
 FloatingTextManager& FloatingTextManager::getInstance() {
-    static FloatingTextManager instance;
+    static FloatingTextManager instance(DataManager::getInstance());
     return instance;
 }
 
-std::string
-FloatingTextManager::getDynamicTextContent(const std::string& name, const FloatingTextData& data, Player* player) {
-    std::string baseText = data.text;
+namespace {
+// 将维度与水平区域坐标打包为一个键
+uint64_t regionKey(int dimid, int rx, int rz) {
+    return ((uint64_t)(uint8_t)dimid << 56) | (((uint64_t)(uint32_t)rx & 0xFFFFFFF) << 28)
+         | ((uint64_t)(uint32_t)rz & 0xFFFFFFF);
+}
+
+int regionCoord(float v, float size) { return (int)std::floor(v / size); }
+
+uint64_t regionOf(DimensionType dimid, const Vec3& pos, float size) {
+    return regionKey((int)dimid, regionCoord(pos.x, size), regionCoord(pos.z, size));
+}
+
+// IDebugText 与协程帧的实际大小无法从外部获取，使用固定估算值
+constexpr size_t kShapeBytesEstimate = 256;
+constexpr size_t kTaskFrameBytesEstimate =
+    512 + sizeof(ll::coro::CoroTask<>) + sizeof(std::string) + sizeof(FloatingTextData);
+} // namespace
+
+void FloatingTextManager::noteAllocation(size_t bytes) {
+    if (bytes > kSsoCapacity) {
+        ++mTickAllocations;
+        ++mRenderStats.allocations;
+    }
+}
+
+void FloatingTextManager::beginRenderPass() {
+    // 进入新的服务器刻时结算上一刻的分配次数
+    uint64_t tick = currentTick();
+    if (mStatsTickOpen && tick == mStatsTick) {
+        return;
+    }
+    if (mStatsTickOpen) {
+        ++mRenderStats.ticks;
+        mRenderStats.closedTickAllocations += mTickAllocations;
+        mRenderStats.lastTickAllocations    = mTickAllocations;
+        mRenderStats.maxTickAllocations     = std::max(mRenderStats.maxTickAllocations, mTickAllocations);
+    }
+    mTickAllocations = 0;
+    mStatsTick       = tick;
+    mStatsTickOpen   = true;
+}
+
+void FloatingTextManager::endRenderPass() { ++mRenderStats.passes; }
+
+std::chrono::steady_clock::time_point FloatingTextManager::now() const {
+    return mSimulating ? mSimulatedNow : std::chrono::steady_clock::now();
+}
+
+uint64_t FloatingTextManager::currentTick() const {
+    if (mSimulating) {
+        return (uint64_t)((mSimulatedNow - std::chrono::steady_clock::time_point{}) / kServerTickDuration);
+    }
+    auto level = ll::service::getLevel();
+    return level ? level->getCurrentServerTick().tickID : 0;
+}
+
+std::time_t FloatingTextManager::currentTime() const {
+    if (mSimulating) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            mSimulatedNow - std::chrono::steady_clock::time_point{}
+        );
+        return std::chrono::system_clock::to_time_t(mSimulatedWallStart + elapsed);
+    }
+    return std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+}
 
-    if (name == "time_text") {
-        auto    now       = std::chrono::system_clock::now();
-        auto    in_time_t = std::chrono::system_clock::to_time_t(now);
+const std::string& FloatingTextManager::formatCurrentTime() {
+    auto now = currentTime();
+    if (now != mTimeCache.second) {
         std::tm tm_buf;
-        localtime_s(&tm_buf, &in_time_t); // Use localtime_s for thread safety on Windows
+        localtime_s(&tm_buf, &now); // Use localtime_s for thread safety on Windows
+
+        char   buf[32];
+        size_t len = std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm_buf);
 
-        std::ostringstream oss;
-        oss << "当前时间: " << std::put_time(&tm_buf, "%Y-%m-%d %H:%M:%S");
-        baseText = oss.str();
+        size_t oldCapacity = mTimeCache.text.capacity();
+        mTimeCache.text.assign("当前时间: ").append(buf, len);
+        if (mTimeCache.text.capacity() != oldCapacity) {
+            noteAllocation(mTimeCache.text.capacity());
+        }
+        mTimeCache.second = now;
     }
+    return mTimeCache.text;
+}
+
+std::string_view FloatingTextManager::getDynamicTextContent(
+    const std::string&      name,
+    const FloatingTextData& data,
+    Player*                 player,
+    std::string&            replaced
+) {
+    // 时间文本与原文本均有稳定的存储，直接作为替换的输入，无需复制
+    const std::string& baseText = name == "time_text" ? formatCurrentTime() : data.text;
 
     // 使用 PlaceholderAPI 替换占位符
- auto paService = PA::PA_GetPlaceholderService();
-if (paService) {
+    auto paService = PA::PA_GetPlaceholderService();
+    if (!paService) {
+        return baseText;
+    }
+
     if (player) {
         auto ctx = PA::PlayerContext::factory(player);
-        return paService->replace(baseText, ctx.get());
+        // PlayerContext 本身为一次堆分配
+        ++mTickAllocations;
+        ++mRenderStats.allocations;
+        replaced = paService->replace(baseText, ctx.get());
+    } else {
+        replaced = paService->replaceServer(baseText);
+    }
+    noteAllocation(replaced.capacity());
+    return replaced;
+}
+
+template <class Fn>
+void FloatingTextManager::forEachViewer(Fn&& fn) {
+    if (mSimulating) {
+        for (auto const& viewer : mSimulatedViewers) {
+            fn(viewer);
+        }
+        return;
+    }
+    auto level = ll::service::getLevel();
+    if (level) {
+        level->forEachPlayer([&](Player& player) {
+            fn(Viewer{&player, player.getDimensionId(), player.getPosition()});
+            return true;
+        });
+    }
+}
+
+void FloatingTextManager::draw(debug_shape::IDebugText& shape, Player* player) {
+    if (mDrawer) {
+        mDrawer->draw(shape, player);
+    } else if (player) {
+        debug_shape::IDebugShapeDrawer::getInstance().drawShape(shape, *player);
     } else {
-        return paService->replaceServer(baseText);
+        debug_shape::IDebugShapeDrawer::getInstance().drawShape(shape);
     }
 }
-return baseText;
+
+void FloatingTextManager::setShapeText(debug_shape::IDebugText& shape, std::string_view text, std::string& replaced) {
+    if (text.data() == replaced.data()) {
+        shape.setText(std::move(replaced)); // 替换结果直接移入形状
+    } else {
+        shape.setText(std::string{text});
+        noteAllocation(text.size());
+    }
+}
+
+bool FloatingTextManager::renderDynamicText(const std::string& name, const FloatingTextData& data) {
+    // 获取 DebugText 对象，已被回收时不再重建
+    auto it = mDebugTexts.find(name);
+    if (it == mDebugTexts.end() || !it->second) {
+        return false;
+    }
+    auto& debugText = it->second;
+
+    // 获取所有在线玩家
+    beginRenderPass();
+    if (mSimulating || ll::service::getLevel()) {
+        forEachViewer([&](const Viewer& viewer) {
+            // 获取最新的文本内容，针对每个玩家
+            std::string      replaced;
+            std::string_view newText = getDynamicTextContent(name, data, viewer.player, replaced);
+
+            if (debugText->getText() != newText) { // 避免不必要的更新
+                setShapeText(*debugText, newText, replaced);
+                ++mRenderStats.textUpdates;
+                // 重新绘制以使更改生效，针对特定玩家
+                draw(*debugText, viewer.player);
+            }
+        });
+    } else {
+        // 如果没有玩家，仍然更新服务器级文本
+        std::string      replaced;
+        std::string_view newText = getDynamicTextContent(name, data, nullptr, replaced);
+        if (debugText->getText() != newText) { // 避免不必要的更新
+            setShapeText(*debugText, newText, replaced);
+            ++mRenderStats.textUpdates;
+            // 重新绘制以使更改生效
+            draw(*debugText, nullptr);
+            logger.debug("Updated dynamic text {} to: {}", name, newText);
+        }
+    }
+    endRenderPass();
+    return true;
 }
 
 ll::coro::CoroTask<> FloatingTextManager::updateDynamicTextTask(
     std::string        name,
     FloatingTextData   data, // 复制数据，因为协程可能在数据管理器之外运行
+    uint64_t           generation,
     std::atomic<bool>& runningFlag
 ) {
     logger.debug("Dynamic text update task started for: {}", name);
     while (runningFlag) {
-        // 获取 DebugText 对象
-        if (!mDebugTexts.contains(name)) {
-            // 如果不存在，则创建
-            mDebugTexts[name] = debug_shape::IDebugText::create(data.pos, data.text);
-            logger.debug("Created new IDebugText for: {}", name);
-        }
-        auto& debugText = mDebugTexts[name];
-
-        if (!debugText) {
+        if (!renderDynamicText(name, data)) {
             logger.warn("Dynamic text {} is null, stopping update task.", name);
             break; // 如果 DebugText 不存在，则停止此任务
         }
 
-        // 获取所有在线玩家
-        auto level = ll::service::getLevel();
-        if (level) {
-            level->forEachPlayer([&](Player& player) {
-                // 获取最新的文本内容，针对每个玩家
-                std::string newText = getDynamicTextContent(name, data, &player);
-
-                if (debugText->getText() != newText) { // 避免不必要的更新
-                    debugText->setText(newText);
-                    // 重新绘制以使更改生效，针对特定玩家
-                    debug_shape::IDebugShapeDrawer::getInstance().drawShape(*debugText, player);
-                }
-                return true; // 继续遍历
-            });
-        } else {
-            // 如果没有玩家，仍然更新服务器级文本
-            std::string newText = getDynamicTextContent(name, data, nullptr);
-            if (debugText->getText() != newText) { // 避免不必要的更新
-                debugText->setText(newText);
-                // 重新绘制以使更改生效
-                debug_shape::IDebugShapeDrawer::getInstance().drawShape(*debugText);
-                logger.debug("Updated dynamic text {} to: {}", name, newText);
-            }
-        }
-
         // 等待指定间隔
         if (data.interval.has_value() && data.interval.value() > 0) {
             co_await std::chrono::milliseconds(data.interval.value());
@@ -110,11 +246,20 @@ ll::coro::CoroTask<> FloatingTextManager::updateDynamicTextTask(
             // 如果没有设置间隔或间隔为0，则默认等待1秒，防止无限循环
             co_await std::chrono::seconds(1);
         }
+        // 文本已被回收或重新激活时退出
+        if (!isCurrentTask(name, generation)) {
+            break;
+        }
     }
     logger.debug("Dynamic text update task stopped for: {}", name);
     co_return;
 }
 
+bool FloatingTextManager::isCurrentTask(const std::string& name, uint64_t generation) const {
+    auto it = mDynamicTextTasks.find(name);
+    return it != mDynamicTextTasks.end() && it->second.generation == generation;
+}
+
 void FloatingTextManager::addStaticText(const std::string& name, const FloatingTextData& data) {
     logger.debug("Adding static text: {}", name);
     if (mDebugTexts.contains(name)) {
@@ -127,19 +272,19 @@ void FloatingTextManager::addStaticText(const std::string& name, const FloatingT
         return;
     }
 
-    auto level = ll::service::getLevel();
-    if (level) {
-        level->forEachPlayer([&](Player& player) {
-            debug_shape::IDebugShapeDrawer::getInstance().drawShape(*debugText, player);
-            return true;
-        });
-    }
+    forEachViewer([&](const Viewer& viewer) { draw(*debugText, viewer.player); });
 
     mDebugTexts.emplace(name, std::move(debugText));
 }
 
 void FloatingTextManager::removeText(const std::string& name) {
-    if (mDynamicTextTasks.contains(name)) {
+    unindexText(name);
+    deactivateText(name);
+}
+
+void FloatingTextManager::deactivateText(const std::string& name) {
+    mActiveTexts.erase(name);
+    if (mDynamicTextTasks.contains(name) || mSimulatedSchedule.contains(name)) {
         stopDynamicTextUpdate(name); // This also erases from mDebugTexts
     } else if (mDebugTexts.contains(name)) {
         logger.debug("Removing static text: {}", name);
@@ -154,30 +299,40 @@ void FloatingTextManager::startDynamicTextUpdate(const std::string& name, const
         logger.warn("Attempted to start dynamic update for static text: {}", name);
         return;
     }
-    if (mDynamicTextTasks.contains(name)) {
+    if (mDynamicTextTasks.contains(name) || mSimulatedSchedule.contains(name)) {
         logger.warn("Dynamic text update task for {} is already running. Stopping existing task.", name);
-        stopDynamicTextUpdate(name);
+        // 只替换任务，保留 activateText 创建的形状
+        mDynamicTextTasks.erase(name);
+        mSimulatedSchedule.erase(name);
     }
 
     logger.debug("Starting dynamic text update for: {}", name);
+    if (mSimulating) {
+        // 模拟时由 advanceSimulation 按虚拟时钟驱动刷新
+        mSimulatedSchedule.emplace(name, SimulatedSchedule{data, now()});
+        return;
+    }
     // 启动协程并存储其句柄
-    auto task = ll::coro::keepThis(
-        [this](std::string n, FloatingTextData d, std::atomic<bool>& flag) {
-            return updateDynamicTextTask(std::move(n), std::move(d), flag);
+    uint64_t generation = ++mNextTaskGeneration;
+    auto     task       = ll::coro::keepThis(
+        [this](std::string n, FloatingTextData d, uint64_t gen, std::atomic<bool>& flag) {
+            return updateDynamicTextTask(std::move(n), std::move(d), gen, flag);
         },
         name,
         data,
+        generation,
         std::ref(mRunning)
     );
     task.launch(ll::thread::ServerThreadExecutor::getDefault());
-    mDynamicTextTasks.emplace(name, std::move(task));
+    mDynamicTextTasks.emplace(name, DynamicTextTask{generation, std::move(task)});
 }
 
 void FloatingTextManager::stopDynamicTextUpdate(const std::string& name) {
-    if (mDynamicTextTasks.contains(name)) {
+    if (mDynamicTextTasks.contains(name) || mSimulatedSchedule.contains(name)) {
         logger.debug("Stopping dynamic text update for: {}", name);
         // 协程的析构函数会自动销毁句柄，从而停止任务
         mDynamicTextTasks.erase(name);
+        mSimulatedSchedule.erase(name);
         // 同时删除 DebugText 实例
         mDebugTexts.erase(name);
     } else {
@@ -185,13 +340,224 @@ void FloatingTextManager::stopDynamicTextUpdate(const std::string& name) {
     }
 }
 
+void FloatingTextManager::drawAllTexts(Player* player) {
+    for (auto const& [name, debugText] : mDebugTexts) {
+        if (debugText) {
+            draw(*debugText, player);
+        }
+    }
+}
+
 void FloatingTextManager::showAllTextsToPlayer(Player& player) {
     logger.debug("Showing all floating texts to player: {}", player.getRealName());
+    drawAllTexts(&player);
+}
+
+std::unordered_set<uint64_t> FloatingTextManager::collectNearbyRegions() {
+    std::unordered_set<uint64_t> nearby;
+    forEachViewer([&](const Viewer& viewer) {
+        // 玩家所在区域及其相邻区域内的文本视为在范围内
+        int rx = regionCoord(viewer.pos.x, kRegionSize);
+        int rz = regionCoord(viewer.pos.z, kRegionSize);
+        for (int dx = -1; dx <= 1; ++dx) {
+            for (int dz = -1; dz <= 1; ++dz) {
+                nearby.insert(regionKey((int)viewer.dimid, rx + dx, rz + dz));
+            }
+        }
+    });
+    return nearby;
+}
+
+void FloatingTextManager::loadViewerDimensions() {
+    forEachViewer([&](const Viewer& viewer) { mData.ensureDimensionLoaded(viewer.dimid); });
+}
+
+void FloatingTextManager::onShardLoaded(std::vector<std::string> const& names) {
+    if (!mRunning) {
+        return; // loadAndShowAllTexts 时统一登记
+    }
+    auto        nearby  = collectNearbyRegions();
+    auto        current = now();
+    auto const& texts   = mData.getAllFloatingTexts();
+    for (auto const& name : names) {
+        auto it = texts.find(name);
+        if (it == texts.end()) {
+            continue;
+        }
+        if (!mTextRegions.contains(name)) {
+            logger.debug("Registering floating text {} from a newly loaded shard.", name);
+        }
+        indexText(name, it->second);
+        updateActivation(name, it->second, nearby, current);
+    }
+}
+
+void FloatingTextManager::updateActivation(
+    const std::string&                    name,
+    const FloatingTextData&               data,
+    const std::unordered_set<uint64_t>&   nearby,
+    std::chrono::steady_clock::time_point now
+) {
+    if (!nearby.contains(regionOf(data.dimid, data.pos, kRegionSize))) {
+        return;
+    }
+    auto it = mActiveTexts.find(name);
+    if (it == mActiveTexts.end()) {
+        activateText(name, data);
+        mActiveTexts[name] = now;
+    } else {
+        it->second = now;
+    }
+}
+
+void FloatingTextManager::activateText(const std::string& name, const FloatingTextData& data) {
+    logger.debug("Activating floating text: {}", name);
+    if (data.type == FloatingTextType::Dynamic) {
+        if (mDynamicTextTasks.contains(name) || mSimulatedSchedule.contains(name)) {
+            stopDynamicTextUpdate(name);
+        }
+        // 形状只在激活时创建，刷新循环不会重建已回收的形状
+        auto debugText = debug_shape::IDebugText::create(data.pos, data.text);
+        if (!debugText) {
+            logger.error("Failed to create IDebugText for dynamic text {}", name);
+            return;
+        }
+        mDebugTexts.insert_or_assign(name, std::move(debugText));
+        startDynamicTextUpdate(name, data);
+    } else {
+        addStaticText(name, data);
+    }
+}
+
+MemoryUsage FloatingTextManager::getMemoryUsage() const {
+    MemoryUsage usage;
+    usage.data = mData.estimateMemoryUsage();
+
+    usage.shapes = mDebugTexts.bucket_count() * 2 * sizeof(void*);
     for (auto const& [name, debugText] : mDebugTexts) {
+        usage.shapes += kNodeBytes<std::unique_ptr<debug_shape::IDebugText>> + stringHeapBytes(name);
         if (debugText) {
-            debug_shape::IDebugShapeDrawer::getInstance().drawShape(*debugText, player);
+            usage.shapes += kShapeBytesEstimate + stringHeapBytes(debugText->getText());
+        }
+    }
+
+    usage.tasks = mDynamicTextTasks.bucket_count() * 2 * sizeof(void*);
+    for (auto const& [name, task] : mDynamicTextTasks) {
+        usage.tasks += kNodeBytes<DynamicTextTask> + kTaskFrameBytesEstimate + stringHeapBytes(name) * 2;
+    }
+    if (mActivationTask) {
+        usage.tasks += kTaskFrameBytesEstimate;
+    }
+
+    usage.caches = stringHeapBytes(mTimeCache.text)
+                 + mActiveTexts.bucket_count() * 2 * sizeof(void*)
+                 + (mRegionTexts.bucket_count() + mTextRegions.bucket_count()) * 2 * sizeof(void*)
+                 + mData.estimateHistoryMemoryUsage();
+    for (auto const& [name, lastSeen] : mActiveTexts) {
+        usage.caches += kNodeBytes<std::chrono::steady_clock::time_point> + stringHeapBytes(name);
+    }
+    for (auto const& [key, names] : mRegionTexts) {
+        usage.caches += kNodeBytes<std::unordered_set<std::string>> + names.bucket_count() * 2 * sizeof(void*);
+    }
+    for (auto const& [name, key] : mTextRegions) {
+        // 名称在两个索引中各存一份
+        usage.caches += kNodeBytes<uint64_t> * 2 + stringHeapBytes(name) * 2;
+    }
+    return usage;
+}
+
+MemoryUsage FloatingTextManager::getTextMemoryUsage(const std::string& name) const {
+    MemoryUsage usage;
+    usage.data = mData.estimateTextMemoryUsage(name);
+    if (auto it = mDebugTexts.find(name); it != mDebugTexts.end()) {
+        usage.shapes = kNodeBytes<std::unique_ptr<debug_shape::IDebugText>> + stringHeapBytes(name);
+        if (it->second) {
+            usage.shapes += kShapeBytesEstimate + stringHeapBytes(it->second->getText());
+        }
+    }
+    if (mDynamicTextTasks.contains(name)) {
+        usage.tasks = kNodeBytes<DynamicTextTask> + kTaskFrameBytesEstimate + stringHeapBytes(name) * 2;
+    }
+    if (mActiveTexts.contains(name)) {
+        usage.caches = kNodeBytes<std::chrono::steady_clock::time_point> + stringHeapBytes(name);
+    }
+    if (mTextRegions.contains(name)) {
+        usage.caches += kNodeBytes<uint64_t> * 2 + stringHeapBytes(name) * 2;
+    }
+    return usage;
+}
+
+void FloatingTextManager::indexText(const std::string& name, const FloatingTextData& data) {
+    unindexText(name);
+    auto key = regionOf(data.dimid, data.pos, kRegionSize);
+    mRegionTexts[key].insert(name);
+    mTextRegions.emplace(name, key);
+}
+
+void FloatingTextManager::unindexText(const std::string& name) {
+    auto it = mTextRegions.find(name);
+    if (it == mTextRegions.end()) {
+        return;
+    }
+    auto region = mRegionTexts.find(it->second);
+    if (region != mRegionTexts.end()) {
+        region->second.erase(name);
+        if (region->second.empty()) {
+            mRegionTexts.erase(region);
+        }
+    }
+    mTextRegions.erase(it);
+}
+
+void FloatingTextManager::registerText(const std::string& name, const FloatingTextData& data) {
+    removeText(name);
+    if (!mRunning) {
+        return; // loadAndShowAllTexts 时统一登记
+    }
+    indexText(name, data);
+    updateActivation(name, data, collectNearbyRegions(), now());
+}
+
+void FloatingTextManager::refreshActivation() {
+    loadViewerDimensions();
+    auto        nearby  = collectNearbyRegions();
+    auto        current = now();
+    auto const& texts   = mData.getAllFloatingTexts();
+
+    // 只检查玩家附近区域中登记的文本
+    for (auto key : nearby) {
+        auto region = mRegionTexts.find(key);
+        if (region == mRegionTexts.end()) {
+            continue;
+        }
+        for (auto const& name : region->second) {
+            if (auto it = texts.find(name); it != texts.end()) {
+                updateActivation(name, it->second, nearby, current);
+            }
+        }
+    }
+
+    // 回收超出保留时间仍无人靠近的文本
+    std::vector<std::string> expired;
+    for (auto const& [name, lastSeen] : mActiveTexts) {
+        if (current - lastSeen >= kActivationGracePeriod) {
+            expired.push_back(name);
         }
     }
+    for (auto const& name : expired) {
+        logger.debug("No players near floating text {}, deactivating.", name);
+        deactivateText(name);
+    }
+}
+
+ll::coro::CoroTask<> FloatingTextManager::activationScanTask(uint64_t generation, std::atomic<bool>& runningFlag) {
+    logger.debug("Activation scan task started.");
+    while (runningFlag && generation == mActivationGeneration) {
+        refreshActivation();
+        co_await kActivationScanInterval;
+    }
+    logger.debug("Activation scan task stopped.");
+    co_return;
 }
 
 void FloatingTextManager::loadAndShowAllTexts() {
@@ -200,15 +566,25 @@ void FloatingTextManager::loadAndShowAllTexts() {
         return;
     }
     mRunning = true;
-    logger.debug("Loading and showing all floating texts...");
-    auto& allFloatingTexts = DataManager::getInstance().getAllFloatingTexts();
-    for (auto const& [name, data] : allFloatingTexts) {
-        if (data.type == FloatingTextType::Dynamic) {
-            startDynamicTextUpdate(name, data);
-        } else {
-            addStaticText(name, data);
-        }
+    for (auto const& [name, data] : mData.getAllFloatingTexts()) {
+        indexText(name, data);
+    }
+    logger.debug("Registered {} floating texts, activating those near players...", mTextRegions.size());
+    refreshActivation();
+    if (mSimulating) {
+        mNextSimulatedScan = now() + kActivationScanInterval;
+        return; // 模拟时由 advanceSimulation 驱动区域扫描
     }
+
+    // 启动区域扫描协程
+    uint64_t generation = ++mActivationGeneration;
+    auto     task       = ll::coro::keepThis(
+        [this](uint64_t gen, std::atomic<bool>& flag) { return activationScanTask(gen, flag); },
+        generation,
+        std::ref(mRunning)
+    );
+    task.launch(ll::thread::ServerThreadExecutor::getDefault());
+    mActivationTask.emplace(std::move(task));
 }
 
 void FloatingTextManager::unloadAllTexts() {
@@ -218,8 +594,66 @@ void FloatingTextManager::unloadAllTexts() {
     }
     mRunning = false; // 设置标志位，通知所有协程停止
     logger.debug("Unloading all floating texts...");
+    ++mActivationGeneration;
+    mActivationTask.reset();
+    mActiveTexts.clear();
+    mRegionTexts.clear();
+    mTextRegions.clear();
     mDynamicTextTasks.clear(); // 清除所有任务，这将导致协程句柄被销毁
+    mSimulatedSchedule.clear();
     mDebugTexts.clear();       // 清除所有 DebugText 实例
 }
 
+void FloatingTextManager::beginSimulation(ITextDrawer& drawer, std::chrono::system_clock::time_point wallStart) {
+    if (mRunning) {
+        unloadAllTexts();
+    }
+    logger.debug("Entering floating text simulation.");
+    mSimulating         = true;
+    mDrawer             = &drawer;
+    mSimulatedNow       = std::chrono::steady_clock::time_point{};
+    mNextSimulatedScan  = mSimulatedNow;
+    mSimulatedWallStart = wallStart;
+    mSimulatedViewers.clear();
+}
+
+void FloatingTextManager::setSimulatedViewers(std::vector<Viewer> viewers) { mSimulatedViewers = std::move(viewers); }
+
+void FloatingTextManager::showAllTextsToViewer(const Viewer& viewer) { drawAllTexts(viewer.player); }
+
+void FloatingTextManager::advanceSimulation(std::chrono::steady_clock::duration elapsed) {
+    if (!mSimulating || !mRunning) {
+        return;
+    }
+    mSimulatedNow = std::chrono::steady_clock::time_point{} + elapsed;
+    if (mSimulatedNow >= mNextSimulatedScan) {
+        refreshActivation();
+        mNextSimulatedScan = mSimulatedNow + kActivationScanInterval;
+    }
+
+    for (auto& [name, schedule] : mSimulatedSchedule) {
+        if (schedule.nextUpdate > mSimulatedNow) {
+            continue;
+        }
+        renderDynamicText(name, schedule.data);
+        auto interval = schedule.data.interval.value_or(0) > 0
+                          ? std::chrono::steady_clock::duration(std::chrono::milliseconds(*schedule.data.interval))
+                          : std::chrono::steady_clock::duration(std::chrono::seconds(1));
+        schedule.nextUpdate = mSimulatedNow + interval;
+    }
+}
+
+void FloatingTextManager::endSimulation() {
+    if (!mSimulating) {
+        return;
+    }
+    if (mRunning) {
+        unloadAllTexts();
+    }
+    logger.debug("Leaving floating text simulation.");
+    mSimulating = false;
+    mDrawer     = nullptr;
+    mSimulatedViewers.clear();
+}
+
 } // namespace HFloatingText
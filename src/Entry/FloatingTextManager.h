@@ -7,40 +7,205 @@
 #include "debug_shape/api/shape/IDebugText.h"
 #include "debug_shape/api/IDebugShapeDrawer.h"
 
+#include <ctime>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <memory>
 #include <atomic>
 #include <chrono>
 #include <functional>
+#include <optional>
+#include <unordered_set>
+#include <vector>
 
 namespace HFloatingText {
 
+// 动态文本渲染统计
+// 堆分配次数只是估算：按本模组可见的字符串增长和每个 PlayerContext 一次计数，
+// 不包含 PlaceholderAPI 内部及 IDebugText::setText 内部的分配
+struct RenderStats {
+    uint64_t passes{};                // 已完成的渲染轮次（每次刷新一条动态文本为一轮）
+    uint64_t ticks{};                 // 已结束的、发生过渲染的服务器刻数
+    uint64_t allocations{};           // 累计估算堆分配次数（含当前未结束的刻）
+    uint64_t closedTickAllocations{}; // 已结束的刻内的估算堆分配次数，用于计算每刻平均值
+    uint64_t lastTickAllocations{};   // 最近一个已结束的刻内的估算堆分配次数
+    uint64_t maxTickAllocations{};    // 单个服务器刻内的最大估算堆分配次数
+    uint64_t textUpdates{};           // 实际发生变化并下发的文本次数
+};
+
+// 内存占用估算（字节），按子系统划分
+struct MemoryUsage {
+    size_t data{};   // DataManager 中的文本数据
+    size_t shapes{}; // IDebugText 实例
+    size_t tasks{};  // 动态文本协程帧
+    size_t caches{}; // 时间缓存、激活记录、区域索引和变更历史
+
+    [[nodiscard]] size_t total() const { return data + shapes + tasks + caches; }
+};
+
+// 观察者：在线玩家，或回放中的虚拟玩家（player 为空）
+struct Viewer {
+    Player*       player;
+    DimensionType dimid;
+    Vec3          pos;
+};
+
+// 绘制接口，默认转发到 IDebugShapeDrawer；回放时替换为只计数、不发包的实现
+class ITextDrawer {
+public:
+    virtual ~ITextDrawer() = default;
+
+    virtual void draw(debug_shape::IDebugText& shape, Player* player) = 0;
+};
+
 class FloatingTextManager {
 private:
-    std::unordered_map<std::string, ll::coro::CoroTask<>> mDynamicTextTasks;
-    std::atomic<bool>                                      mRunning;
+    DataManager& mData;
+
+    // 动态文本任务，generation 用于让已被停止的协程在恢复后立即退出
+    struct DynamicTextTask {
+        uint64_t             generation;
+        ll::coro::CoroTask<> task;
+    };
+    std::unordered_map<std::string, DynamicTextTask> mDynamicTextTasks;
+    uint64_t                                         mNextTaskGeneration{};
+    std::atomic<bool>                                mRunning;
 
     // 存储 IDebugText 实例的映射
     std::unordered_map<std::string, std::unique_ptr<debug_shape::IDebugText>> mDebugTexts;
 
-    FloatingTextManager();
-    ~FloatingTextManager();
+    // 时间文本缓存，同一秒内直接复用已格式化的结果
+    struct TimeTextCache {
+        std::time_t second{-1};
+        std::string text;
+    } mTimeCache;
+
+    // 渲染统计按服务器刻归并，同一刻内多条动态文本的刷新计入同一刻
+    static constexpr std::chrono::milliseconds kServerTickDuration{50};
+
+    RenderStats mRenderStats;
+    uint64_t    mTickAllocations{};
+    uint64_t    mStatsTick{};
+    bool        mStatsTickOpen = false;
+
+    // 懒激活：文本仅在有玩家进入其所在区域时才创建形状并启动动态任务。
+    // 玩家所在区域及相邻 8 个区域内的文本会被激活，因此实际激活距离为 128–256 格（取决于玩家在区域内的位置）
+    static constexpr float                kRegionSize = 128.0f; // 区域边长（格）
+    static constexpr std::chrono::seconds kActivationGracePeriod{30}; // 区域无人后的保留时间
+    static constexpr std::chrono::seconds kActivationScanInterval{1};
+
+    // 已激活文本 -> 最近一次有玩家在范围内的时间
+    std::unordered_map<std::string, std::chrono::steady_clock::time_point> mActiveTexts;
+    std::optional<ll::coro::CoroTask<>>                                    mActivationTask;
+    uint64_t                                                               mActivationGeneration{};
+
+    // 区域索引：区域键 -> 该区域内已登记的文本，扫描时只检查玩家附近区域中的文本
+    std::unordered_map<uint64_t, std::unordered_set<std::string>> mRegionTexts;
+    std::unordered_map<std::string, uint64_t>                     mTextRegions;
+
+    // 回放模拟状态：虚拟时钟、虚拟玩家和替换的绘制接口，动态文本按计划表而非协程刷新
+    struct SimulatedSchedule {
+        FloatingTextData                      data;
+        std::chrono::steady_clock::time_point nextUpdate;
+    };
+    bool                                               mSimulating = false;
+    ITextDrawer*                                       mDrawer     = nullptr;
+    std::vector<Viewer>                                mSimulatedViewers;
+    std::chrono::steady_clock::time_point              mSimulatedNow;
+    std::chrono::steady_clock::time_point              mNextSimulatedScan;
+    std::chrono::system_clock::time_point              mSimulatedWallStart;
+    std::unordered_map<std::string, SimulatedSchedule> mSimulatedSchedule;
+
+    // 当前时间与服务器刻，模拟时使用虚拟时钟
+    [[nodiscard]] std::chrono::steady_clock::time_point now() const;
+    [[nodiscard]] std::time_t                           currentTime() const;
+    [[nodiscard]] uint64_t                              currentTick() const;
+
+    // 返回当前时间文本，仅在秒数变化时重新格式化
+    const std::string& formatCurrentTime();
+
+    // 遍历在线玩家或模拟中的虚拟玩家
+    template <class Fn>
+    void forEachViewer(Fn&& fn);
+
+    // 绘制形状，player 为空时绘制给所有玩家
+    void draw(debug_shape::IDebugText& shape, Player* player);
+    void drawAllTexts(Player* player);
+
+    // 更新形状文本；text 指向 replaced 时直接移入，否则复制
+    void setShapeText(debug_shape::IDebugText& shape, std::string_view text, std::string& replaced);
+
+    // 刷新一次动态文本的内容并下发给各观察者，形状不存在时返回 false（形状只由 activateText 创建）
+    bool renderDynamicText(const std::string& name, const FloatingTextData& data);
+
+    // 记录一次可能的堆分配（超出 SSO 容量时才计数）
+    void noteAllocation(size_t bytes);
+
+    void beginRenderPass();
+    void endRenderPass();
 
     // 协程任务函数，用于更新单个动态文本
     ll::coro::CoroTask<> updateDynamicTextTask(
         std::string name,
         FloatingTextData data,
+        uint64_t generation,
         std::atomic<bool>& runningFlag
     );
+    // 任务是否仍是该文本当前登记的任务
+    [[nodiscard]] bool isCurrentTask(const std::string& name, uint64_t generation) const;
+
+    // 定期扫描玩家位置并激活/回收文本的协程
+    ll::coro::CoroTask<> activationScanTask(uint64_t generation, std::atomic<bool>& runningFlag);
+
+    // 收集玩家所在区域及其相邻区域
+    std::unordered_set<uint64_t> collectNearbyRegions();
+
+    // 按需加载玩家所在维度的数据分片，新加载的文本经 onShardLoaded 登记
+    void loadViewerDimensions();
+    // DataManager 加载分片后的回调：登记分片中的文本并激活玩家附近的部分
+    void onShardLoaded(std::vector<std::string> const& names);
+
+    // 文本位于附近区域时激活或续期
+    void updateActivation(
+        const std::string&                    name,
+        const FloatingTextData&               data,
+        const std::unordered_set<uint64_t>&   nearby,
+        std::chrono::steady_clock::time_point now
+    );
+
+    void activateText(const std::string& name, const FloatingTextData& data);
+    // 销毁形状和动态任务，文本仍保留在区域索引中
+    void deactivateText(const std::string& name);
+
+    void indexText(const std::string& name, const FloatingTextData& data);
+    void unindexText(const std::string& name);
 
 public:
     static FloatingTextManager& getInstance();
 
+    // 绑定到指定的数据源；全局实例使用 DataManager::getInstance()，回放时使用独立的内存实例
+    explicit FloatingTextManager(DataManager& data);
+    ~FloatingTextManager();
+
+    // 登记文本，若已有玩家在范围内则立即激活
+    void registerText(const std::string& name, const FloatingTextData& data);
+
+    // 扫描玩家附近区域内登记的文本并更新激活状态，回收超出保留时间的文本
+    void refreshActivation();
+
+    // 已激活的文本数量
+    [[nodiscard]] size_t getActiveTextCount() const { return mActiveTexts.size(); }
+
+    // 估算整体及单条文本的内存占用
+    [[nodiscard]] MemoryUsage getMemoryUsage() const;
+    [[nodiscard]] MemoryUsage getTextMemoryUsage(const std::string& name) const;
+
     // 添加静态文本
     void addStaticText(const std::string& name, const FloatingTextData& data);
 
-    // 移除文本（静态或动态）
+    // 移除文本（静态或动态），同时取消登记
     void removeText(const std::string& name);
 
     // 启动单个动态文本的更新
@@ -52,14 +217,31 @@ class FloatingTextManager {
     // 向指定玩家显示所有悬浮字
     void showAllTextsToPlayer(Player& player);
 
-    // 加载并显示所有悬浮字
+    // 登记所有悬浮字，并显示已有玩家在范围内的部分
     void loadAndShowAllTexts();
 
     // 卸载所有悬浮字
     void unloadAllTexts();
 
-    // 获取动态文本的当前内容 (示例，后续可扩展)
-    std::string getDynamicTextContent(const std::string& name, const FloatingTextData& data, Player* player);
+    // 获取动态文本的当前内容。启用 PlaceholderAPI 时替换结果写入 replaced 并返回其视图，调用方可将其直接移入形状；
+    // 未启用时返回原文本或时间缓存的视图，不产生复制
+    std::string_view getDynamicTextContent(
+        const std::string&      name,
+        const FloatingTextData& data,
+        Player*                 player,
+        std::string&            replaced
+    );
+
+    // 获取渲染统计
+    [[nodiscard]] RenderStats const& getRenderStats() const { return mRenderStats; }
+
+    // 回放模拟：由调用方驱动虚拟时钟与虚拟玩家，绘制全部交给 drawer；应在独立实例上使用，不影响在线玩家
+    void beginSimulation(ITextDrawer& drawer, std::chrono::system_clock::time_point wallStart);
+    void setSimulatedViewers(std::vector<Viewer> viewers);
+    void showAllTextsToViewer(const Viewer& viewer);
+    // 推进虚拟时钟到 elapsed，执行期间到期的区域扫描与动态文本刷新
+    void advanceSimulation(std::chrono::steady_clock::duration elapsed);
+    void endSimulation();
 };
 
 } // namespace HFloatingText
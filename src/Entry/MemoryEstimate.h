@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+
+namespace HFloatingText {
+
+// 内存占用估算的公共工具，结果均为近似值
+
+// 短字符串优化容量，超出该长度的字符串才会触发堆分配
+inline const size_t kSsoCapacity = std::string{}.capacity();
+
+// 字符串在堆上占用的字节数，短字符串优化范围内为 0
+inline size_t stringHeapBytes(const std::string& str) {
+    return str.capacity() > kSsoCapacity ? str.capacity() + 1 : 0;
+}
+
+// 以字符串为键的哈希表节点：键值对 + 链表指针 + 缓存的哈希值
+template <class V>
+inline constexpr size_t kNodeBytes = sizeof(std::pair<const std::string, V>) + 3 * sizeof(void*);
+
+} // namespace HFloatingText
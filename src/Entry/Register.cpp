@@ -1,8 +1,11 @@
 #include "Entry/Register.h"
 #include "Entry/DataManager.h"
 #include "Entry/Entry.h"
+#include "Entry/ReplayDriver.h"
+#include "Entry/TraceRecorder.h"
 #include "debug_shape/api/shape/IDebugText.h"
 #include "debug_shape/api/IDebugShapeDrawer.h"
+#include "fmt/format.h"
 #include "ll/api/command/CommandHandle.h"
 #include "ll/api/command/CommandRegistrar.h"
 #include "ll/api/command/Overload.h"
@@ -15,6 +18,7 @@
 #include "mc/server/commands/CommandPosition.h"
 #include "mc/server/commands/CommandPositionFloat.h"
 #include "mc/world/level/dimension/Dimension.h"
+#include <filesystem>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -42,29 +46,39 @@ struct EditCommand {
 struct DeleteCommand {
     std::string name;
 };
+struct MemoryCommand {
+    std::string name;
+};
+struct ReloadShardCommand {
+    std::string shard;
+};
+struct TraceCommand {
+    std::string name;
+};
 
 
 void editFloatingText(const CommandOrigin& origin, CommandOutput& output, const EditCommand& param) {
     logger.debug("Editing floating text: name={}, text={}", param.name, param.text);
 
-    auto& allTexts = DataManager::getInstance().getAllFloatingTexts();
-    if (!allTexts.contains(param.name)) {
+    auto const* existing = DataManager::getInstance().findFloatingText(param.name);
+    if (!existing) {
         output.error("Floating text with this name does not exist.");
         logger.debug("Floating text with name {} does not exist.", param.name);
         return;
     }
 
-    auto& data = allTexts.at(param.name);
-    data.text  = param.text;
-    DataManager::getInstance().save();
+    auto data = *existing;
+    data.text = param.text;
+    if (auto error = DataManager::getInstance().validate(param.name, data)) {
+        output.error(*error);
+        logger.debug("Rejected edit of floating text {}: {}", param.name, *error);
+        return;
+    }
+    DataManager::getInstance().addOrUpdateFloatingText(param.name, data);
+    TraceRecorder::getInstance().recordUpsert(param.name, data);
 
     // Reload the text to apply changes
-    FloatingTextManager::getInstance().removeText(param.name);
-    if (data.type == FloatingTextType::Dynamic) {
-        FloatingTextManager::getInstance().startDynamicTextUpdate(param.name, data);
-    } else {
-        FloatingTextManager::getInstance().addStaticText(param.name, data);
-    }
+    FloatingTextManager::getInstance().registerText(param.name, data);
 
     output.success("Floating text updated.");
     logger.debug("Successfully updated floating text with name {}.", param.name);
@@ -73,8 +87,7 @@ void editFloatingText(const CommandOrigin& origin, CommandOutput& output, const
 void deleteFloatingText(const CommandOrigin& origin, CommandOutput& output, const DeleteCommand& param) {
     logger.debug("Deleting floating text: name={}", param.name);
 
-    auto& allTexts = DataManager::getInstance().getAllFloatingTexts();
-    if (!allTexts.contains(param.name)) {
+    if (!DataManager::getInstance().hasFloatingText(param.name)) {
         output.error("Floating text with this name does not exist.");
         logger.debug("Floating text with name {} does not exist.", param.name);
         return;
@@ -82,6 +95,7 @@ void deleteFloatingText(const CommandOrigin& origin, CommandOutput& output, cons
 
     DataManager::getInstance().removeFloatingText(param.name);
     FloatingTextManager::getInstance().removeText(param.name);
+    TraceRecorder::getInstance().recordRemove(param.name);
     output.success("Floating text deleted.");
     logger.debug("Successfully deleted floating text with name {}.", param.name);
 }
@@ -110,8 +124,7 @@ void registerCommands() {
                 param.text,
                 param.dimid
             );
-            auto& allTexts = DataManager::getInstance().getAllFloatingTexts();
-            if (allTexts.contains(param.name)) {
+            if (DataManager::getInstance().hasFloatingText(param.name)) {
                 output.error("Floating text with this name already exists.");
                 logger.debug("Floating text with name {} already exists.", param.name);
                 return;
@@ -125,8 +138,14 @@ void registerCommands() {
                 (DimensionType)param.dimid,
                 FloatingTextType::Static,
                 std::nullopt};
+            if (auto error = DataManager::getInstance().validate(param.name, newData)) {
+                output.error(*error);
+                logger.debug("Rejected static floating text {}: {}", param.name, *error);
+                return;
+            }
             DataManager::getInstance().addOrUpdateFloatingText(param.name, newData);
-            FloatingTextManager::getInstance().addStaticText(param.name, newData);
+            FloatingTextManager::getInstance().registerText(param.name, newData);
+            TraceRecorder::getInstance().recordUpsert(param.name, newData);
 
             output.success("Floating text created.");
             logger.debug("Successfully created static floating text with name {}.", param.name);
@@ -152,8 +171,7 @@ void registerCommands() {
                 param.dimid,
                 param.interval
             );
-            auto& allTexts = DataManager::getInstance().getAllFloatingTexts();
-            if (allTexts.contains(param.name)) {
+            if (DataManager::getInstance().hasFloatingText(param.name)) {
                 output.error("Floating text with this name already exists.");
                 logger.debug("Floating text with name {} already exists.", param.name);
                 return;
@@ -167,8 +185,14 @@ void registerCommands() {
                 (DimensionType)param.dimid,
                 FloatingTextType::Dynamic,
                 param.interval};
+            if (auto error = DataManager::getInstance().validate(param.name, newData)) {
+                output.error(*error);
+                logger.debug("Rejected dynamic floating text {}: {}", param.name, *error);
+                return;
+            }
             DataManager::getInstance().addOrUpdateFloatingText(param.name, newData);
-            FloatingTextManager::getInstance().startDynamicTextUpdate(param.name, newData);
+            FloatingTextManager::getInstance().registerText(param.name, newData);
+            TraceRecorder::getInstance().recordUpsert(param.name, newData);
 
             output.success("Dynamic floating text created.");
             logger.debug("Successfully created dynamic floating text with name {}.", param.name);
@@ -195,8 +219,161 @@ void registerCommands() {
         .text("reload")
         .execute([](const CommandOrigin& origin, CommandOutput& output) {
             Entry::getInstance().reloadAllFloatingTexts();
+            TraceRecorder::getInstance().recordReload();
             output.success("All floating texts have been reloaded.");
         });
+
+    command.overload<ReloadShardCommand>()
+        .text("reloadshard")
+        .required("shard")
+        .execute([](const CommandOrigin& origin, CommandOutput& output, const ReloadShardCommand& param) {
+            if (!DataManager::getInstance().hasShard(param.shard)) {
+                output.error("Shard with this key does not exist.");
+                return;
+            }
+            if (!Entry::getInstance().reloadShard(param.shard)) {
+                output.error("Failed to reload shard.");
+                return;
+            }
+            output.success("Shard has been reloaded.");
+        });
+
+    command.overload()
+        .text("migrate")
+        .execute([](const CommandOrigin& origin, CommandOutput& output) {
+            if (DataManager::getInstance().isSharded()) {
+                output.error("Floating texts are already stored in shards.");
+                return;
+            }
+            auto& config           = Entry::getInstance().getConfig();
+            config.storage.sharded = true;
+            if (!Entry::getInstance().saveConfig()) {
+                config.storage.sharded = false;
+                output.error("Failed to save configuration.");
+                return;
+            }
+            // 重新加载时会自动将 floating_texts.json 拆分为分片文件
+            Entry::getInstance().reloadAllFloatingTexts();
+            output.success("Floating texts have been migrated to sharded storage.");
+        });
+
+    command.overload()
+        .text("stats")
+        .execute([](const CommandOrigin& origin, CommandOutput& output) {
+            auto const& stats = FloatingTextManager::getInstance().getRenderStats();
+            // 平均值只计算已结束的刻，当前刻仍在累计
+            double avg = stats.ticks > 0 ? (double)stats.closedTickAllocations / (double)stats.ticks : 0.0;
+            output.success(fmt::format(
+                "Active texts: {}, render passes: {}, text updates: {}, estimated allocations: {} (avg {:.2f}/tick, "
+                "last tick {}, max {}/tick over {} ticks)",
+                FloatingTextManager::getInstance().getActiveTextCount(),
+                stats.passes,
+                stats.textUpdates,
+                stats.allocations,
+                avg,
+                stats.lastTickAllocations,
+                stats.maxTickAllocations,
+                stats.ticks
+            ));
+        });
+
+    command.overload<MemoryCommand>()
+        .text("memory")
+        .optional("name")
+        .execute([](const CommandOrigin& origin, CommandOutput& output, const MemoryCommand& param) {
+            auto& manager = FloatingTextManager::getInstance();
+            if (!param.name.empty() && !DataManager::getInstance().hasFloatingText(param.name)) {
+                output.error("Floating text with this name does not exist.");
+                return;
+            }
+            auto usage = param.name.empty() ? manager.getMemoryUsage() : manager.getTextMemoryUsage(param.name);
+            output.success(fmt::format(
+                "{}: total {} bytes (data {}, shapes {}, tasks {}, caches {})",
+                param.name.empty() ? "HFloatingText" : param.name,
+                usage.total(),
+                usage.data,
+                usage.shapes,
+                usage.tasks,
+                usage.caches
+            ));
+        });
+
+    command.overload<TraceCommand>()
+        .text("record")
+        .text("start")
+        .required("name")
+        .execute([](const CommandOrigin& origin, CommandOutput& output, const TraceCommand& param) {
+            if (TraceRecorder::getInstance().isRecording()) {
+                output.error("A trace is already being recorded.");
+                return;
+            }
+            if (!TraceRecorder::getTracePath(param.name)) {
+                output.error("Trace names may only contain letters, digits, '_' and '-'.");
+                return;
+            }
+            if (!TraceRecorder::getInstance().start(param.name)) {
+                output.error("Failed to start recording.");
+                return;
+            }
+            output.success("Recording floating text trace.");
+        });
+
+    command.overload()
+        .text("record")
+        .text("stop")
+        .execute([](const CommandOrigin& origin, CommandOutput& output) {
+            if (!TraceRecorder::getInstance().isRecording()) {
+                output.error("No trace is being recorded.");
+                return;
+            }
+            TraceRecorder::getInstance().stop();
+            output.success("Recording stopped.");
+        });
+
+    command.overload<TraceCommand>()
+        .text("replay")
+        .required("name")
+        .execute([](const CommandOrigin& origin, CommandOutput& output, const TraceCommand& param) {
+            auto path = TraceRecorder::getTracePath(param.name);
+            if (!path || !std::filesystem::exists(*path)) {
+                output.error("Trace with this name does not exist.");
+                return;
+            }
+            std::string name    = param.name;
+            bool        started = ReplayDriver::getInstance().start(*path, [name](auto const& report) {
+                if (!report) {
+                    logger.error("Failed to replay trace {}.", name);
+                    return;
+                }
+                logger.info(
+                    "Replay of trace {}:\n"
+                    "Replayed {} events over {} ticks in {:.3f}s ({:.0f} events/s, {:.0f} ticks/s)\n"
+                    "Tick latency ms: p50 {:.3f}, p90 {:.3f}, p99 {:.3f}, max {:.3f}\n"
+                    "Packets: {}, text updates: {}, estimated allocations: {}",
+                    name,
+                    report->events,
+                    report->ticks,
+                    report->wallSeconds,
+                    report->eventsPerSecond,
+                    report->ticksPerSecond,
+                    report->p50TickMs,
+                    report->p90TickMs,
+                    report->p99TickMs,
+                    report->maxTickMs,
+                    report->packets,
+                    report->textUpdates,
+                    report->allocations
+                );
+            });
+            if (!started) {
+                output.error(
+                    ReplayDriver::getInstance().isRunning() ? "A trace is already being replayed."
+                                                            : "Failed to replay trace."
+                );
+                return;
+            }
+            output.success("Replaying trace; the report will be written to the server log.");
+        });
     logger.debug("HFloatingText commands registered.");
 }
 
@@ -0,0 +1,248 @@
+#include "Entry/ReplayDriver.h"
+#include "Entry/DataManager.h"
+#include "Entry/FloatingTextManager.h"
+#include "ll/api/thread/ServerThreadExecutor.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+namespace HFloatingText {
+
+using json = nlohmann::json;
+
+namespace {
+
+// 只计数不发包的绘制实现
+class CountingDrawer : public ITextDrawer {
+public:
+    uint64_t packets = 0;
+
+    void draw(debug_shape::IDebugText&, Player*) override { ++packets; }
+};
+
+Viewer parseViewer(const json& event) {
+    Viewer viewer{nullptr, (DimensionType)event.at("dimid").get<int>(), Vec3::ZERO()};
+    event.at("pos").at("x").get_to(viewer.pos.x);
+    event.at("pos").at("y").get_to(viewer.pos.y);
+    event.at("pos").at("z").get_to(viewer.pos.z);
+    return viewer;
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    auto index = (size_t)(p * (double)(sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+} // namespace
+
+// 一次回放的全部状态，数据与显示均为独立实例
+struct ReplayState {
+    std::filesystem::path         path;
+    ReplayDriver::Callback        onFinished;
+    std::vector<json>             events;
+    std::chrono::milliseconds     lastEvent{};
+    DataManager                   data;
+    FloatingTextManager           texts;
+    CountingDrawer                drawer;
+    std::map<std::string, Viewer> viewers;
+    std::vector<double>           tickMs;
+    size_t                        next    = 1;
+    size_t                        applied = 0;
+
+    explicit ReplayState(std::unordered_map<std::string, FloatingTextData> initialTexts)
+    : data(std::move(initialTexts)),
+      texts(data) {}
+
+    void syncViewers() {
+        std::vector<Viewer> list;
+        list.reserve(viewers.size());
+        for (auto const& [name, viewer] : viewers) {
+            list.push_back(viewer);
+        }
+        texts.setSimulatedViewers(std::move(list));
+    }
+
+    void apply(const json& event) {
+        auto const& type = event.at("type").get_ref<const std::string&>();
+        if (type == "upsert") {
+            auto name     = event.at("name").get<std::string>();
+            auto textData = event.at("data").get<FloatingTextData>();
+            data.addOrUpdateFloatingText(name, textData);
+            texts.registerText(name, textData);
+        } else if (type == "remove") {
+            auto name = event.at("name").get<std::string>();
+            data.removeFloatingText(name);
+            texts.removeText(name);
+        } else if (type == "reload") {
+            texts.unloadAllTexts();
+            texts.loadAndShowAllTexts();
+        } else if (type == "join" || type == "move") {
+            auto& viewer = viewers[event.at("player").get<std::string>()] = parseViewer(event);
+            syncViewers();
+            if (type == "join") {
+                texts.showAllTextsToViewer(viewer);
+            }
+        } else if (type == "leave") {
+            viewers.erase(event.at("player").get<std::string>());
+            syncViewers();
+        } else if (type == "dimension") {
+            auto it = viewers.find(event.at("player").get<std::string>());
+            if (it != viewers.end()) {
+                it->second = parseViewer(event);
+                syncViewers();
+                texts.showAllTextsToViewer(it->second);
+            }
+        }
+    }
+};
+
+ReplayDriver::ReplayDriver()  = default;
+ReplayDriver::~ReplayDriver() = default;
+
+ReplayDriver& ReplayDriver::getInstance() {
+    static ReplayDriver instance;
+    return instance;
+}
+
+bool ReplayDriver::start(const std::filesystem::path& path, Callback onFinished) {
+    if (isRunning()) {
+        logger.warn("A trace is already being replayed.");
+        return false;
+    }
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        logger.error("Cannot open trace file {}", path.string());
+        return false;
+    }
+
+    std::vector<json>                                 events;
+    std::unordered_map<std::string, FloatingTextData> initialTexts;
+    std::chrono::system_clock::time_point             wallStart;
+    std::chrono::milliseconds                         lastEvent;
+    try {
+        std::string line;
+        while (std::getline(file, line)) {
+            if (!line.empty()) {
+                events.push_back(json::parse(line));
+            }
+        }
+        if (events.empty() || events.front().at("type") != "snapshot") {
+            logger.error("Trace file {} does not start with a snapshot.", path.string());
+            return false;
+        }
+        initialTexts = events.front().at("texts").get<std::unordered_map<std::string, FloatingTextData>>();
+        wallStart    = std::chrono::system_clock::from_time_t(events.front().at("start").get<std::time_t>());
+        lastEvent    = std::chrono::milliseconds(events.back().at("t").get<int64_t>());
+    } catch (const json::exception&) {
+        logger.error("Trace file {} is malformed.", path.string());
+        return false;
+    }
+
+    mState             = std::make_unique<ReplayState>(std::move(initialTexts));
+    mState->path       = path;
+    mState->onFinished = std::move(onFinished);
+    mState->events     = std::move(events);
+    mState->lastEvent  = lastEvent;
+    mState->texts.beginSimulation(mState->drawer, wallStart);
+    mState->texts.loadAndShowAllTexts();
+
+    uint64_t generation = ++mGeneration;
+    auto     task       = ll::coro::keepThis([this](uint64_t gen) { return replayTask(gen); }, generation);
+    task.launch(ll::thread::ServerThreadExecutor::getDefault());
+    mTask.emplace(std::move(task));
+    logger.info("Replaying floating text trace {}", path.string());
+    return true;
+}
+
+void ReplayDriver::cancel() {
+    if (!isRunning()) {
+        return;
+    }
+    ++mGeneration;
+    mTask.reset();
+    mState.reset();
+    logger.info("Cancelled floating text trace replay.");
+}
+
+ll::coro::CoroTask<> ReplayDriver::replayTask(uint64_t generation) {
+    bool success    = true;
+    auto sliceStart = std::chrono::steady_clock::now();
+    for (std::chrono::milliseconds virtualNow{0}; virtualNow <= mState->lastEvent + kTickDuration;
+         virtualNow += kTickDuration) {
+        auto& state     = *mState;
+        auto  tickStart = std::chrono::steady_clock::now();
+        try {
+            while (state.next < state.events.size()
+                   && state.events[state.next].at("t").get<int64_t>() <= virtualNow.count()) {
+                state.apply(state.events[state.next++]);
+                ++state.applied;
+            }
+            state.texts.advanceSimulation(virtualNow);
+        } catch (const json::exception&) {
+            logger.error(
+                "Trace file {} contains a malformed event after {} events.",
+                state.path.string(),
+                state.applied
+            );
+            success = false;
+            break;
+        }
+        auto tickEnd = std::chrono::steady_clock::now();
+        state.tickMs.push_back(std::chrono::duration<double, std::milli>(tickEnd - tickStart).count());
+
+        // 超出本刻预算后让出服务器线程
+        if (tickEnd - sliceStart >= kBudgetPerTick) {
+            co_await kTickDuration;
+            if (generation != mGeneration) {
+                co_return;
+            }
+            sliceStart = std::chrono::steady_clock::now();
+        }
+    }
+    finish(success);
+    co_return;
+}
+
+void ReplayDriver::finish(bool success) {
+    auto state = std::move(mState);
+    state->texts.endSimulation();
+
+    std::optional<ReplayReport> report;
+    if (success) {
+        auto&  tickMs = state->tickMs;
+        auto   stats  = state->texts.getRenderStats();
+        double wall   = 0.0;
+        for (double ms : tickMs) {
+            wall += ms / 1000.0;
+        }
+
+        report.emplace();
+        report->events          = state->applied;
+        report->ticks           = tickMs.size();
+        report->wallSeconds     = wall;
+        report->eventsPerSecond = wall > 0 ? (double)state->applied / wall : 0.0;
+        report->ticksPerSecond  = wall > 0 ? (double)tickMs.size() / wall : 0.0;
+        std::sort(tickMs.begin(), tickMs.end());
+        report->p50TickMs   = percentile(tickMs, 0.50);
+        report->p90TickMs   = percentile(tickMs, 0.90);
+        report->p99TickMs   = percentile(tickMs, 0.99);
+        report->maxTickMs   = tickMs.empty() ? 0.0 : tickMs.back();
+        report->packets     = state->drawer.packets;
+        report->allocations = stats.allocations;
+        report->textUpdates = stats.textUpdates;
+    }
+    if (state->onFinished) {
+        state->onFinished(report);
+    }
+}
+
+} // namespace HFloatingText
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "ll/api/coro/CoroTask.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+
+namespace HFloatingText {
+
+struct ReplayReport {
+    size_t   events{};        // 回放的事件数
+    size_t   ticks{};         // 模拟的服务器刻数
+    double   wallSeconds{};   // 回放实际占用的时间（不含让出给服务器的时间）
+    double   eventsPerSecond{};
+    double   ticksPerSecond{};
+    double   p50TickMs{};     // 单刻耗时百分位
+    double   p90TickMs{};
+    double   p99TickMs{};
+    double   maxTickMs{};
+    uint64_t packets{};       // 发出的绘制次数
+    uint64_t allocations{};   // 渲染路径上的估算堆分配次数，口径同 RenderStats
+    uint64_t textUpdates{};
+};
+
+struct ReplayState;
+
+// 将 TraceRecorder 录制的文件按虚拟时钟回放。
+// 回放在独立的 DataManager 与 FloatingTextManager 实例上进行，绘制只计数不发包，不影响在线数据和玩家看到的悬浮字；
+// 模拟过程分摊到多个服务器刻执行，每刻最多占用 kBudgetPerTick。
+class ReplayDriver {
+public:
+    using Callback = std::function<void(std::optional<ReplayReport> const&)>;
+
+    static constexpr std::chrono::milliseconds kTickDuration{50};
+    static constexpr std::chrono::milliseconds kBudgetPerTick{10};
+
+    static ReplayDriver& getInstance();
+
+    ReplayDriver(const ReplayDriver&)            = delete;
+    ReplayDriver(ReplayDriver&&)                 = delete;
+    ReplayDriver& operator=(const ReplayDriver&) = delete;
+    ReplayDriver& operator=(ReplayDriver&&)      = delete;
+
+    // 读取并开始回放，完成后在服务器线程调用 onFinished（文件格式错误时参数为 nullopt）。
+    // 文件无法读取、格式错误或已有回放在进行时返回 false，此时不会调用 onFinished
+    bool start(const std::filesystem::path& path, Callback onFinished);
+    // 中止进行中的回放，不调用 onFinished
+    void cancel();
+
+    [[nodiscard]] bool isRunning() const { return mState != nullptr; }
+
+private:
+    ReplayDriver();
+    ~ReplayDriver();
+
+    ll::coro::CoroTask<> replayTask(uint64_t generation);
+    void                 finish(bool success);
+
+    std::unique_ptr<ReplayState>        mState;
+    std::optional<ll::coro::CoroTask<>> mTask;
+    uint64_t                            mGeneration{};
+};
+
+} // namespace HFloatingText
@@ -0,0 +1,180 @@
+#include "Entry/TraceRecorder.h"
+#include "Entry/Entry.h"
+#include "ll/api/coro/CoroTask.h"
+#include "ll/api/service/Bedrock.h"
+#include "ll/api/thread/ServerThreadExecutor.h"
+#include "logger.h"
+#include "mc/world/actor/player/Player.h"
+#include "mc/world/level/Level.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace HFloatingText {
+
+using json = nlohmann::json;
+
+TraceRecorder& TraceRecorder::getInstance() {
+    static TraceRecorder instance;
+    return instance;
+}
+
+std::optional<std::filesystem::path> TraceRecorder::getTracePath(const std::string& name) {
+    bool valid = !name.empty() && std::all_of(name.begin(), name.end(), [](char c) {
+        return std::isalnum((unsigned char)c) || c == '_' || c == '-';
+    });
+    if (!valid) {
+        return std::nullopt;
+    }
+    return Entry::getInstance().getSelf().getDataDir() / "traces" / (name + ".jsonl");
+}
+
+bool TraceRecorder::start(const std::string& name) {
+    if (isRecording()) {
+        logger.warn("A trace is already being recorded.");
+        return false;
+    }
+    auto path = getTracePath(name);
+    if (!path) {
+        return false;
+    }
+
+    try {
+        std::filesystem::create_directories(path->parent_path());
+    } catch (const std::filesystem::filesystem_error&) {
+        return false; // Failed to create directory
+    }
+    mFile.open(*path, std::ios::out | std::ios::trunc);
+    if (!mFile.is_open()) {
+        return false;
+    }
+
+    mStart = std::chrono::steady_clock::now();
+    mLastSamples.clear();
+
+    // 首行写入当前全部悬浮字，回放从相同的初始状态开始
+    json texts = json::object();
+    for (auto const& [textName, data] : DataManager::getInstance().getAllFloatingTexts()) {
+        texts[textName] = data;
+    }
+    json snapshot;
+    snapshot["start"] = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    snapshot["texts"] = std::move(texts);
+    write("snapshot", std::move(snapshot));
+
+    // 已在线的玩家记录为加入
+    if (auto level = ll::service::getLevel()) {
+        level->forEachPlayer([&](Player& player) {
+            recordJoin(player);
+            return true;
+        });
+    }
+
+    uint64_t generation = ++mGeneration;
+    auto     task       = ll::coro::keepThis([this](uint64_t gen) { return sampleTask(gen); }, generation);
+    task.launch(ll::thread::ServerThreadExecutor::getDefault());
+    mSampleTask.emplace(std::move(task));
+
+    logger.info("Started recording floating text trace to {}", path->string());
+    return true;
+}
+
+void TraceRecorder::stop() {
+    if (!isRecording()) {
+        return;
+    }
+    ++mGeneration;
+    mSampleTask.reset();
+    mFile.close();
+    mLastSamples.clear();
+    logger.info("Stopped recording floating text trace.");
+}
+
+void TraceRecorder::write(std::string_view type, json event) {
+    if (!isRecording()) {
+        return;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - mStart);
+    event["t"]    = elapsed.count();
+    event["type"] = std::string(type);
+    mFile << event.dump() << '\n';
+}
+
+void TraceRecorder::writePlayer(std::string_view type, Player& player) {
+    writePlayer(type, player.getRealName(), (int)player.getDimensionId(), player.getPosition());
+}
+
+void TraceRecorder::writePlayer(std::string_view type, const std::string& name, int dimid, const Vec3& pos) {
+    json event;
+    event["player"] = name;
+    event["dimid"]  = dimid;
+    event["pos"]    = {
+        {"x", pos.x},
+        {"y", pos.y},
+        {"z", pos.z}
+    };
+    write(type, std::move(event));
+    mLastSamples[name] = {dimid, pos};
+}
+
+void TraceRecorder::recordUpsert(const std::string& name, const FloatingTextData& data) {
+    json event;
+    event["name"] = name;
+    event["data"] = data;
+    write("upsert", std::move(event));
+}
+
+void TraceRecorder::recordRemove(const std::string& name) { write("remove", {{"name", name}}); }
+
+void TraceRecorder::recordReload() { write("reload", json::object()); }
+
+void TraceRecorder::recordJoin(Player& player) {
+    if (isRecording()) {
+        writePlayer("join", player);
+    }
+}
+
+void TraceRecorder::recordLeave(Player& player) {
+    if (isRecording()) {
+        write("leave", {{"player", player.getRealName()}});
+        mLastSamples.erase(player.getRealName());
+    }
+}
+
+void TraceRecorder::recordDimensionChange(Player& player, DimensionType toDimid, const Vec3& toPos) {
+    if (isRecording()) {
+        writePlayer("dimension", player.getRealName(), (int)toDimid, toPos);
+    }
+}
+
+void TraceRecorder::samplePlayers() {
+    auto level = ll::service::getLevel();
+    if (!level) {
+        return;
+    }
+    level->forEachPlayer([&](Player& player) {
+        auto const& pos = player.getPosition();
+        auto        it  = mLastSamples.find(player.getRealName());
+        if (it == mLastSamples.end() || it->second.dimid != (int)player.getDimensionId()) {
+            writePlayer("move", player);
+        } else {
+            float dx = pos.x - it->second.pos.x;
+            float dy = pos.y - it->second.pos.y;
+            float dz = pos.z - it->second.pos.z;
+            if (dx * dx + dy * dy + dz * dz >= kMoveThreshold * kMoveThreshold) {
+                writePlayer("move", player);
+            }
+        }
+        return true;
+    });
+}
+
+ll::coro::CoroTask<> TraceRecorder::sampleTask(uint64_t generation) {
+    while (isRecording() && generation == mGeneration) {
+        samplePlayers();
+        co_await kSampleInterval;
+    }
+    co_return;
+}
+
+} // namespace HFloatingText
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Entry/DataManager.h"
+#include "ll/api/coro/CoroTask.h"
+#include "mc/deps/core/math/Vec3.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+class Player;
+
+namespace HFloatingText {
+
+// 录制 /hft 指令与玩家进出、移动、切换维度事件，供 ReplayDriver 离线回放
+// 文件格式为 JSON Lines，首行为录制开始时全部悬浮字的快照，每行的 t 为距录制开始的毫秒数
+class TraceRecorder {
+public:
+    static TraceRecorder& getInstance();
+
+    TraceRecorder(const TraceRecorder&)            = delete;
+    TraceRecorder(TraceRecorder&&)                 = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(TraceRecorder&&)      = delete;
+
+    // 录制文件位于 traces/<name>.jsonl，名称只允许字母、数字、下划线和连字符
+    static std::optional<std::filesystem::path> getTracePath(const std::string& name);
+
+    bool start(const std::string& name);
+    void stop();
+
+    [[nodiscard]] bool isRecording() const { return mFile.is_open(); }
+
+    void recordUpsert(const std::string& name, const FloatingTextData& data);
+    void recordRemove(const std::string& name);
+    void recordReload();
+    void recordJoin(Player& player);
+    void recordLeave(Player& player);
+    void recordDimensionChange(Player& player, DimensionType toDimid, const Vec3& toPos);
+
+private:
+    TraceRecorder()  = default;
+    ~TraceRecorder() = default;
+
+    static constexpr std::chrono::seconds kSampleInterval{1};
+    static constexpr float                kMoveThreshold = 1.0f; // 位置变化超过该距离才记录移动
+
+    struct PlayerSample {
+        int  dimid;
+        Vec3 pos;
+    };
+
+    void write(std::string_view type, nlohmann::json event);
+    void writePlayer(std::string_view type, Player& player);
+    void writePlayer(std::string_view type, const std::string& name, int dimid, const Vec3& pos);
+    void samplePlayers();
+
+    ll::coro::CoroTask<> sampleTask(uint64_t generation);
+
+    std::ofstream                                 mFile;
+    std::chrono::steady_clock::time_point         mStart;
+    std::unordered_map<std::string, PlayerSample> mLastSamples;
+    std::optional<ll::coro::CoroTask<>>           mSampleTask;
+    uint64_t                                      mGeneration{};
+};
+
+} // namespace HFloatingText
@@ -1,12 +1,15 @@
 #include "ll/api/event/EventBus.h"
 #include "ll/api/memory/Hook.h"
+#include "ll/api/event/player/PlayerDisconnectEvent.h"
 #include "ll/api/event/player/PlayerJoinEvent.h"
 #include "mc/world/actor/player/Player.h"
+#include "mc/world/level/ChangeDimensionRequest.h"
 #include "mc/world/level/Level.h"
 #include "mc/world/level/dimension/Dimension.h"
 
 #include "Entry/Entry.h" // 引入 Entry.h
 #include "Entry/FloatingTextManager.h" // 引入 FloatingTextManager.h
+#include "Entry/TraceRecorder.h" // 引入 TraceRecorder.h
 #include "debug_shape/api/IDebugShapeDrawer.h" // 引入 IDebugShapeDrawer.h
 #include "debug_shape/api/shape/IDebugText.h" // 引入 IDebugText.h
 void registerPlayerConnectionListener() {
@@ -15,6 +18,12 @@ void registerPlayerConnectionListener() {
             auto& player = event.self();
             // When a player joins, show all existing floating texts to them.
             HFloatingText::FloatingTextManager::getInstance().showAllTextsToPlayer(player);
+            HFloatingText::TraceRecorder::getInstance().recordJoin(player);
+        }
+    );
+    ll::event::EventBus::getInstance().emplaceListener<ll::event::player::PlayerDisconnectEvent>(
+        [](ll::event::player::PlayerDisconnectEvent& event) {
+            HFloatingText::TraceRecorder::getInstance().recordLeave(event.self());
         }
     );
 }
@@ -30,5 +39,11 @@ LL_AUTO_TYPE_INSTANCE_HOOK(
 ) {
     // When a player changes dimension, re-show all floating texts to them.
     HFloatingText::FloatingTextManager::getInstance().showAllTextsToPlayer(player);
+    // Hook 在切换前触发，玩家的维度与位置仍是旧值，记录请求中的目标维度与位置
+    HFloatingText::TraceRecorder::getInstance().recordDimensionChange(
+        player,
+        *changeRequest.mToDimensionId,
+        *changeRequest.mToLocation
+    );
     return origin(player, std::move(changeRequest));
 }
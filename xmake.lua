@@ -30,7 +30,7 @@ target("HFloatingText") -- Change this to your mod name.
     add_rules("@levibuildscript/linkrule")
     add_rules("@levibuildscript/modpacker")
     add_cxflags( "/EHa", "/utf-8", "/W4", "/w44265", "/w44289", "/w44296", "/w45263", "/w44738", "/w45204")
-    add_defines("NOMINMAX", "UNICODE")
+    add_defines("NOMINMAX", "UNICODE", "HFLOATINGTEXT_EXPORTS")
     add_packages("levilamina","gmlib","debug_shape","placeholder")
     set_exceptions("none") -- To avoid conflicts with /EHa.
     set_kind("shared")